@@ -9,6 +9,13 @@
 #include <iomanip>
 #include <random>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <variant>
 
 using Matrix = std::vector<std::vector<double>>;
 using std::vector;
@@ -22,22 +29,168 @@ namespace algebra {
     // Matrix initialization types
     enum class MatrixType { Zeros, Ones, Identity, Random };
 
-    // Function template for matrix initialization
+    // Error codes returned by the validate_* checks and the try_* functions
+    enum class Errc {
+        Ok = 0,
+        MissingBounds,
+        InvalidBounds,
+        InvalidDimensions,
+        EmptyMatrix,
+        DimensionMismatch,
+        IncompatibleDimensions,
+        NotSquare,
+        Singular,
+        NotImplemented,
+    };
+
+    inline const char* error_message(Errc code) noexcept {
+        switch (code) {
+            case Errc::Ok: return "No error.";
+            case Errc::MissingBounds: return "For random matrix, specify valid lowerBound and upperBound.";
+            case Errc::InvalidBounds: return "lowerBound should be less than upperBound.";
+            case Errc::InvalidDimensions: return "Matrix dimensions must be greater than zero.";
+            case Errc::EmptyMatrix: return "Matrix must not be empty.";
+            case Errc::DimensionMismatch: return "Matrix dimensions must match.";
+            case Errc::IncompatibleDimensions: return "Matrix dimensions are incompatible for this operation.";
+            case Errc::NotSquare: return "Matrix must be square.";
+            case Errc::Singular: return "Matrix is singular and cannot be inverted.";
+            case Errc::NotImplemented: return "Operation currently only implemented for 2x2 matrices.";
+        }
+        return "Unknown error.";
+    }
+
+    // Throw the exception the throwing API has always used for this error
+    [[noreturn]] inline void throw_error(Errc code) {
+        switch (code) {
+            case Errc::MissingBounds:
+            case Errc::InvalidBounds:
+            case Errc::InvalidDimensions:
+                throw std::logic_error(error_message(code));
+            default:
+                throw std::invalid_argument(error_message(code));
+        }
+    }
+
+    // Value-or-error result of the try_* functions (a minimal std::expected for C++20)
     template<typename T>
-    MATRIX<T> create_matrix(std::size_t rows, std::size_t columns, std::optional<MatrixType> type = MatrixType::Zeros,
-                            std::optional<T> lowerBound = std::nullopt, std::optional<T> upperBound = std::nullopt) {
-        // 参数检查
+    class Expected {
+    public:
+        Expected(T value) : state_(std::in_place_index<0>, std::move(value)) {}
+        Expected(Errc code) : state_(std::in_place_index<1>, code) {}
+
+        bool has_value() const noexcept { return state_.index() == 0; }
+        explicit operator bool() const noexcept { return has_value(); }
+        Errc error() const noexcept { return has_value() ? Errc::Ok : *std::get_if<1>(&state_); }
+
+        // Rethrows the error as the exception the throwing API would have raised
+        T& value() & {
+            if (!has_value()) throw_error(error());
+            return *std::get_if<0>(&state_);
+        }
+        const T& value() const & {
+            if (!has_value()) throw_error(error());
+            return *std::get_if<0>(&state_);
+        }
+        T&& value() && { return std::move(value()); }
+
+        T& operator*() noexcept { return *std::get_if<0>(&state_); }
+        const T& operator*() const noexcept { return *std::get_if<0>(&state_); }
+        T* operator->() noexcept { return std::get_if<0>(&state_); }
+        const T* operator->() const noexcept { return std::get_if<0>(&state_); }
+
+        template<typename U>
+        T value_or(U&& fallback) const & { return has_value() ? **this : static_cast<T>(std::forward<U>(fallback)); }
+
+    private:
+        std::variant<T, Errc> state_;
+    };
+
+    // Validation policies. Checked validates every call; Unchecked skips validation
+    // so the caller can run the validate_* check once outside a loop. Defining
+    // ALGEBRA_UNCHECKED makes Unchecked the default for the try_* functions.
+    struct Checked { static constexpr bool enabled = true; };
+    struct Unchecked { static constexpr bool enabled = false; };
+#ifdef ALGEBRA_UNCHECKED
+    using DefaultPolicy = Unchecked;
+#else
+    using DefaultPolicy = Checked;
+#endif
+
+    // Validation checks
+    template<typename T>
+    Errc validate_create_matrix(std::size_t rows, std::size_t columns, std::optional<MatrixType> type,
+                                const std::optional<T>& lowerBound, const std::optional<T>& upperBound) noexcept {
         if (type.value_or(MatrixType::Zeros) == MatrixType::Random) {
-            if (!lowerBound.has_value() || !upperBound.has_value()) {
-                throw std::logic_error("For random matrix, specify valid lowerBound and upperBound.");
-            }
-            if (lowerBound.value() >= upperBound.value()) {
-                throw std::logic_error("lowerBound should be less than upperBound.");
-            }
+            if (!lowerBound.has_value() || !upperBound.has_value()) return Errc::MissingBounds;
+            if (lowerBound.value() >= upperBound.value()) return Errc::InvalidBounds;
         }
+        if (rows == 0 || columns == 0) return Errc::InvalidDimensions;
+        if (type.value_or(MatrixType::Zeros) == MatrixType::Identity && rows != columns) return Errc::NotSquare;
+        return Errc::Ok;
+    }
 
-        if (rows <= 0 || columns <= 0) {
-            throw std::logic_error("Matrix dimensions must be greater than zero.");
+    // Element-wise operations accept two empty matrices
+    template<typename T>
+    Errc validate_same_shape(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB) noexcept {
+        if (matrixA.size() != matrixB.size()) return Errc::DimensionMismatch;
+        if (!matrixA.empty() && matrixA[0].size() != matrixB[0].size()) return Errc::DimensionMismatch;
+        return Errc::Ok;
+    }
+
+    template<typename T>
+    Errc validate_multiply(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB) noexcept {
+        if (matrixA.empty() || matrixB.empty()) return Errc::EmptyMatrix;
+        if (matrixA[0].size() != matrixB.size()) return Errc::IncompatibleDimensions;
+        return Errc::Ok;
+    }
+
+    template<typename T>
+    Errc validate_square(const MATRIX<T>& matrix) noexcept {
+        if (matrix.empty()) return Errc::EmptyMatrix;
+        if (matrix.size() != matrix[0].size()) return Errc::NotSquare;
+        return Errc::Ok;
+    }
+
+    template<typename T>
+    Errc validate_gemv(const MATRIX<T>& A, const std::vector<T>& x, const std::vector<T>& y) noexcept {
+        if (A.empty()) return Errc::EmptyMatrix;
+        if (A[0].size() != x.size() || A.size() != y.size()) return Errc::IncompatibleDimensions;
+        return Errc::Ok;
+    }
+
+    template<typename T>
+    Errc validate_gemv_transposed(const MATRIX<T>& A, const std::vector<T>& x, const std::vector<T>& y) noexcept {
+        if (A.empty()) return Errc::EmptyMatrix;
+        if (A.size() != x.size() || A[0].size() != y.size()) return Errc::IncompatibleDimensions;
+        return Errc::Ok;
+    }
+
+    template<typename T>
+    Errc validate_ger(const MATRIX<T>& A, const std::vector<T>& x, const std::vector<T>& y) noexcept {
+        if (A.empty()) return Errc::EmptyMatrix;
+        if (A.size() != x.size() || A[0].size() != y.size()) return Errc::IncompatibleDimensions;
+        return Errc::Ok;
+    }
+
+    template<typename T>
+    Errc validate_syrk(const MATRIX<T>& A, const MATRIX<T>& C) noexcept {
+        if (A.empty()) return Errc::EmptyMatrix;
+        if (C.size() != A.size() || C[0].size() != A.size()) return Errc::IncompatibleDimensions;
+        return Errc::Ok;
+    }
+
+    // Non-throwing API. Each try_* function returns the result or the error code;
+    // with the Unchecked policy the inputs are assumed to be valid.
+
+    // T cannot be deduced from the arguments, so it comes first:
+    // try_create_matrix<double>(...) uses DefaultPolicy
+    template<typename T, typename Policy = DefaultPolicy>
+    Expected<MATRIX<T>> try_create_matrix(std::size_t rows, std::size_t columns,
+                                          std::optional<MatrixType> type = MatrixType::Zeros,
+                                          std::optional<T> lowerBound = std::nullopt,
+                                          std::optional<T> upperBound = std::nullopt) {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_create_matrix(rows, columns, type, lowerBound, upperBound); code != Errc::Ok) return code;
         }
 
         // 初始化矩阵
@@ -54,10 +207,7 @@ namespace algebra {
                 break;
 
             case MatrixType::Identity:
-                if (rows != columns) {
-                    throw std::logic_error("Identity matrix must be square.");
-                }
-                for (std::size_t i = 0; i < rows; i++) matrix[i][i] = static_cast<T>(1);
+                for (std::size_t i = 0; i < std::min(rows, columns); i++) matrix[i][i] = static_cast<T>(1);
                 break;
 
             case MatrixType::Random: {
@@ -79,47 +229,26 @@ namespace algebra {
         return matrix;
     }
 
-    // Display function
-    // template<typename T>
-    // void display(const MATRIX<T>& matrix) {
-    //     for (const auto& row : matrix) {
-    //         for (const auto& elem : row) {
-    //             std::cout << std::format("{:>7.3f} ", elem); // 右对齐，保留3位小数，总宽度为7
-    //         }
-    //         std::cout << std::endl;
-    //     }
-    // }
-
-    // Matrix addition and subtraction
-    template<typename T>
-    MATRIX<T> sum_sub(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB, std::optional<std::string> operation = "sum") {
-        if (matrixA.size() != matrixB.size() || matrixA[0].size() != matrixB[0].size()) {
-            throw std::invalid_argument("Matrix dimensions must match.");
+    template<typename Policy = DefaultPolicy, typename T>
+    Expected<MATRIX<T>> try_sum_sub(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB,
+                                    std::optional<std::string> operation = "sum") {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_same_shape(matrixA, matrixB); code != Errc::Ok) return code;
         }
-        MATRIX<T> result(matrixA.size(), std::vector<T>(matrixA[0].size()));
-        for (std::size_t i = 0; i < matrixA.size(); ++i) {
-            for (std::size_t j = 0; j < matrixA[0].size(); ++j) {
-                result[i][j] = (operation.value() == "sub") ? (matrixA[i][j] - matrixB[i][j]) : (matrixA[i][j] + matrixB[i][j]);
+        const bool subtract = operation.value() == "sub";
+        MATRIX<T> result(matrixA.size(), std::vector<T>(matrixA.empty() ? 0 : matrixA[0].size()));
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            for (std::size_t j = 0; j < result[i].size(); ++j) {
+                result[i][j] = subtract ? (matrixA[i][j] - matrixB[i][j]) : (matrixA[i][j] + matrixB[i][j]);
             }
         }
         return result;
     }
 
-    // Scalar multiplication
-    template<typename T>
-    MATRIX<T> multiply(const MATRIX<T>& matrix, const T scalar) {
-        MATRIX<T> result = matrix;
-        for (auto& row : result)
-            for (auto& elem : row)
-                elem *= scalar;
-        return result;
-    }
-
-    // Matrix multiplication
-    template<typename T>
-    MATRIX<T> multiply(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB) {
-        if (matrixA[0].size() != matrixB.size()) {
-            throw std::invalid_argument("Matrix dimensions are incompatible for multiplication.");
+    template<typename Policy = DefaultPolicy, typename T>
+    Expected<MATRIX<T>> try_multiply(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB) {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_multiply(matrixA, matrixB); code != Errc::Ok) return code;
         }
         MATRIX<T> result(matrixA.size(), std::vector<T>(matrixB[0].size(), 0));
         for (std::size_t i = 0; i < matrixA.size(); ++i) {
@@ -132,24 +261,24 @@ namespace algebra {
         return result;
     }
 
-    // Hadamard product
-    template<typename T>
-    MATRIX<T> hadamard_product(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB) {
-        if (matrixA.size() != matrixB.size() || matrixA[0].size() != matrixB[0].size()) {
-            throw std::invalid_argument("Matrix dimensions must match.");
+    template<typename Policy = DefaultPolicy, typename T>
+    Expected<MATRIX<T>> try_hadamard_product(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB) {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_same_shape(matrixA, matrixB); code != Errc::Ok) return code;
         }
-        MATRIX<T> result(matrixA.size(), std::vector<T>(matrixA[0].size()));
-        for (std::size_t i = 0; i < matrixA.size(); ++i) {
-            for (std::size_t j = 0; j < matrixA[0].size(); ++j) {
+        MATRIX<T> result(matrixA.size(), std::vector<T>(matrixA.empty() ? 0 : matrixA[0].size()));
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            for (std::size_t j = 0; j < result[i].size(); ++j) {
                 result[i][j] = matrixA[i][j] * matrixB[i][j];
             }
         }
         return result;
     }
 
-    // Transpose
+    // Transpose cannot fail; an empty matrix transposes to an empty matrix
     template<typename T>
     MATRIX<T> transpose(const MATRIX<T>& matrix) {
+        if (matrix.empty()) return {};
         MATRIX<T> result(matrix[0].size(), std::vector<T>(matrix.size()));
         for (std::size_t i = 0; i < matrix.size(); ++i) {
             for (std::size_t j = 0; j < matrix[0].size(); ++j) {
@@ -159,11 +288,10 @@ namespace algebra {
         return result;
     }
 
-    // Trace of a matrix
-    template<typename T>
-    T trace(const MATRIX<T>& matrix) {
-        if (matrix.size() != matrix[0].size()) {
-            throw std::invalid_argument("Matrix must be square to calculate trace.");
+    template<typename Policy = DefaultPolicy, typename T>
+    Expected<T> try_trace(const MATRIX<T>& matrix) noexcept {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_square(matrix); code != Errc::Ok) return code;
         }
         T sum = 0;
         for (std::size_t i = 0; i < matrix.size(); ++i) {
@@ -172,31 +300,362 @@ namespace algebra {
         return sum;
     }
 
+    namespace detail {
+        // The 2x2-only limit of determinant and inverse is a limit of the operation,
+        // not a shape check, so it is reported under either policy; it is O(1)
+        template<typename T>
+        bool is_2x2(const MATRIX<T>& matrix) noexcept {
+            return matrix.size() == 2 && matrix.front().size() == 2 && matrix.back().size() == 2;
+        }
+    } // namespace detail
+
+    // Determinant (for 2x2 matrices as a simple example)
+    template<typename Policy = DefaultPolicy, typename T>
+    Expected<double> try_determinant(const MATRIX<T>& matrix) noexcept {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_square(matrix); code != Errc::Ok) return code;
+        }
+        if (!detail::is_2x2(matrix)) return Errc::NotImplemented;
+        // front()/back() rather than [0]/[1]: GCC cannot see the size check and
+        // warns about row 1 of the 1x1 matrices that take the branch above
+        const auto& top = matrix.front();
+        const auto& bottom = matrix.back();
+        return top[0] * bottom[1] - top[1] * bottom[0];
+    }
+
+    // Inverse (for 2x2 matrices as a simple example); singularity is a property of
+    // the values, not the shape, so it is reported under either policy
+    template<typename Policy = DefaultPolicy, typename T>
+    Expected<MATRIX<double>> try_inverse(const MATRIX<T>& matrix) {
+        if (!detail::is_2x2(matrix)) return Errc::NotImplemented;
+        double det = *try_determinant<Unchecked>(matrix);
+        if (det == 0) return Errc::Singular;
+        const auto& top = matrix.front();
+        const auto& bottom = matrix.back();
+        return MATRIX<double>{{bottom[1] / det, -top[1] / det},
+                              {-bottom[0] / det, top[0] / det}};
+    }
+
+    // Throwing API, built on the checked try_* functions
+
+    // Function template for matrix initialization
+    template<typename T>
+    MATRIX<T> create_matrix(std::size_t rows, std::size_t columns, std::optional<MatrixType> type = MatrixType::Zeros,
+                            std::optional<T> lowerBound = std::nullopt, std::optional<T> upperBound = std::nullopt) {
+        return try_create_matrix<T, Checked>(rows, columns, type, lowerBound, upperBound).value();
+    }
+
+    // Display function
+    // template<typename T>
+    // void display(const MATRIX<T>& matrix) {
+    //     for (const auto& row : matrix) {
+    //         for (const auto& elem : row) {
+    //             std::cout << std::format("{:>7.3f} ", elem); // 右对齐，保留3位小数，总宽度为7
+    //         }
+    //         std::cout << std::endl;
+    //     }
+    // }
+
+    // Matrix addition and subtraction
+    template<typename T>
+    MATRIX<T> sum_sub(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB, std::optional<std::string> operation = "sum") {
+        return try_sum_sub<Checked>(matrixA, matrixB, operation).value();
+    }
+
+    // Scalar multiplication
+    template<typename T>
+    MATRIX<T> multiply(const MATRIX<T>& matrix, const T scalar) {
+        MATRIX<T> result = matrix;
+        for (auto& row : result)
+            for (auto& elem : row)
+                elem *= scalar;
+        return result;
+    }
+
+    // Matrix multiplication
+    template<typename T>
+    MATRIX<T> multiply(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB) {
+        return try_multiply<Checked>(matrixA, matrixB).value();
+    }
+
+    // Hadamard product
+    template<typename T>
+    MATRIX<T> hadamard_product(const MATRIX<T>& matrixA, const MATRIX<T>& matrixB) {
+        return try_hadamard_product<Checked>(matrixA, matrixB).value();
+    }
+
+    // Trace of a matrix
+    template<typename T>
+    T trace(const MATRIX<T>& matrix) {
+        return try_trace<Checked>(matrix).value();
+    }
+
     // Determinant (for 2x2 matrices as a simple example)
     template<typename T>
     double determinant(const MATRIX<T>& matrix) {
-        if (matrix.size() != matrix[0].size()) {
-            throw std::invalid_argument("Matrix must be square to calculate determinant.");
-        }
-        // Example implementation for 2x2 matrix
-        if (matrix.size() == 2) {
-            return matrix[0][0] * matrix[1][1] - matrix[0][1] * matrix[1][0];
-        }
-        throw std::invalid_argument("Determinant calculation for larger matrices not implemented.");
+        return try_determinant<Checked>(matrix).value();
     }
 
     // Inverse (for 2x2 matrices as a simple example)
     template<typename T>
     MATRIX<double> inverse(const MATRIX<T>& matrix) {
-        if (matrix.size() != 2 || matrix[0].size() != 2) {
-            throw std::invalid_argument("Inverse calculation currently only implemented for 2x2 matrices.");
+        return try_inverse<Checked>(matrix).value();
+    }
+
+    namespace detail {
+        // Work (in multiply-adds) below which the vector kernels stay single-threaded.
+        // A multiply-add costs about 0.2 ns serially, so 1 << 18 is ~50 us of work:
+        // handing blocks to sleeping pool workers costs a futex wake-up and a cold
+        // cache per worker (a few us each), which smaller problems do not repay.
+        inline constexpr std::size_t parallel_threshold = 1 << 18;
+
+        // Persistent workers for parallel_for, so a kernel call does not create and
+        // join threads. Idle workers sleep in std::atomic::wait on a wake-up counter
+        // (32 bits, so it is a plain futex on Linux).
+        // One job runs at a time; a caller that finds the pool busy, or that is
+        // itself a pool worker, runs its blocks inline instead of waiting.
+        class WorkerPool {
+        public:
+            explicit WorkerPool(std::size_t workers) {
+                workers_.reserve(workers);
+                for (std::size_t i = 0; i < workers; ++i) workers_.emplace_back([this] { work(); });
+            }
+
+            ~WorkerPool() {
+                stop_.store(true, std::memory_order_relaxed);
+                wake_.fetch_add(1, std::memory_order_release);
+                wake_.notify_all();
+                for (auto& worker : workers_) worker.join();
+            }
+
+            WorkerPool(const WorkerPool&) = delete;
+            WorkerPool& operator=(const WorkerPool&) = delete;
+
+            // One worker per hardware thread besides the caller's, started on first use
+            static WorkerPool& shared() {
+                static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+                return pool;
+            }
+
+            // Threads that take part in a job, counting the caller
+            std::size_t size() const noexcept { return workers_.size() + 1; }
+
+            // Run task(block) for every block in [0, blocks) and return once all are
+            // done; task must not throw
+            template<typename Task>
+            void run(std::size_t blocks, Task& task) {
+                std::unique_lock lock(mutex_, std::try_to_lock);
+                if (!lock || inside_ || blocks <= 1 || blocks > max_blocks) {
+                    for (std::size_t b = 0; b < blocks; ++b) task(b);
+                    return;
+                }
+                task_ = &task;
+                call_ = [](void* t, std::size_t b) { (*static_cast<Task*>(t))(b); };
+                pending_.store(static_cast<std::uint32_t>(blocks), std::memory_order_relaxed);
+                const std::uint64_t job = (ticket_.load(std::memory_order_relaxed) & ~block_mask) + job_one;
+                ticket_.store(job | (std::uint64_t{blocks} << 16), std::memory_order_release);
+                wake_.fetch_add(1, std::memory_order_release);
+                wake_.notify_all();
+
+                inside_ = true;
+                drain(ticket_.load(std::memory_order_acquire));
+                inside_ = false;
+                for (std::uint32_t left = pending_.load(std::memory_order_acquire); left != 0;
+                     left = pending_.load(std::memory_order_acquire)) {
+                    pending_.wait(left, std::memory_order_acquire);
+                }
+            }
+
+        private:
+            // Ticket layout: job id in the high 32 bits, then the block count and the
+            // next unclaimed block (16 bits each). Claiming a block is one CAS on the
+            // ticket, so a worker never mixes up the blocks of two jobs, and the task
+            // cannot change under it: the next job starts only once pending_ is zero.
+            static constexpr std::uint64_t job_one = std::uint64_t{1} << 32;
+            static constexpr std::uint64_t block_mask = job_one - 1;
+            static constexpr std::size_t max_blocks = 0xFFFF;
+
+            void drain(std::uint64_t ticket) {
+                while ((ticket & 0xFFFF) < ((ticket >> 16) & 0xFFFF)) {
+                    if (!ticket_.compare_exchange_weak(ticket, ticket + 1, std::memory_order_acquire)) continue;
+                    call_(task_, static_cast<std::size_t>(ticket & 0xFFFF));
+                    if (pending_.fetch_sub(1, std::memory_order_release) == 1) pending_.notify_one();
+                    ticket = ticket_.load(std::memory_order_acquire);
+                }
+            }
+
+            // A worker may start after jobs, or the destructor, have already bumped
+            // wake_, so it checks for work before its first sleep
+            void work() {
+                inside_ = true;
+                std::uint32_t seen = wake_.load(std::memory_order_acquire);
+                while (!stop_.load(std::memory_order_relaxed)) {
+                    drain(ticket_.load(std::memory_order_acquire));
+                    wake_.wait(seen, std::memory_order_acquire);
+                    seen = wake_.load(std::memory_order_acquire);
+                }
+            }
+
+            std::vector<std::thread> workers_;
+            std::mutex mutex_;
+            std::atomic<std::uint64_t> ticket_{0};
+            std::atomic<std::uint32_t> wake_{0};
+            std::atomic<std::uint32_t> pending_{0};
+            std::atomic<bool> stop_{false};
+            void* task_ = nullptr;
+            void (*call_)(void*, std::size_t) = nullptr;
+            static inline thread_local bool inside_ = false;
+        };
+
+        // Split [0, n) into contiguous blocks, one per pool thread, and run
+        // fn(begin, end) on each; small problems run inline on the caller's thread
+        template<typename Fn>
+        void parallel_for(std::size_t n, std::size_t work, Fn fn) {
+            WorkerPool& pool = WorkerPool::shared();
+            const std::size_t threads = std::min(pool.size(), n);
+            if (threads <= 1 || work < parallel_threshold) {
+                fn(std::size_t{0}, n);
+                return;
+            }
+            const std::size_t block = (n + threads - 1) / threads;
+            auto task = [&](std::size_t b) {
+                const std::size_t begin = b * block;
+                if (begin < n) fn(begin, std::min(n, begin + block));
+            };
+            pool.run(threads, task);
+        }
+
+        // Dot product of two contiguous ranges; four independent accumulators
+        // break the dependency chain so the compiler can vectorize the loop
+        template<typename T>
+        T dot(const T* a, const T* b, std::size_t n) noexcept {
+            T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            std::size_t k = 0;
+            for (; k + 4 <= n; k += 4) {
+                s0 += a[k] * b[k];
+                s1 += a[k + 1] * b[k + 1];
+                s2 += a[k + 2] * b[k + 2];
+                s3 += a[k + 3] * b[k + 3];
+            }
+            for (; k < n; ++k) s0 += a[k] * b[k];
+            return (s0 + s1) + (s2 + s3);
+        }
+
+        // Rows [0, i) of a lower triangle hold i * (i + 1) / 2 elements; returns the
+        // first row at or past element offset w, capped at n. Splitting [0, n(n+1)/2)
+        // evenly and mapping the bounds through it gives every block equal work,
+        // with row boundaries near n * sqrt(b / T).
+        inline std::size_t triangular_row(std::size_t w, std::size_t n) noexcept {
+            auto i = static_cast<std::size_t>((std::sqrt(8.0 * static_cast<double>(w) + 1.0) - 1.0) / 2.0);
+            while (i * (i + 1) / 2 < w) ++i;
+            while (i > 0 && (i - 1) * i / 2 >= w) --i;
+            return std::min(i, n);
         }
-        double det = determinant(matrix);
-        if (det == 0) {
-            throw std::invalid_argument("Matrix is singular and cannot be inverted.");
+
+        // y[0, n) += alpha * x[0, n)
+        template<typename T>
+        void axpy(T alpha, const T* x, T* y, std::size_t n) noexcept {
+            for (std::size_t k = 0; k < n; ++k) y[k] += alpha * x[k];
         }
-        return {{matrix[1][1] / det, -matrix[0][1] / det},
-                {-matrix[1][0] / det, matrix[0][0] / det}};
+    } // namespace detail
+
+    // The in-place kernels below have no try_* form: they throw on invalid shapes
+    // under the default Checked policy, which ALGEBRA_UNCHECKED does not change;
+    // kernel<Unchecked>(...) skips the check after a hoisted validate_*
+
+    // Matrix-vector product (GEMV): y = alpha * A * x + beta * y
+    template<typename Policy = Checked, typename T>
+    void gemv(const MATRIX<T>& A, const std::vector<T>& x, std::vector<T>& y,
+              const T alpha = static_cast<T>(1), const T beta = static_cast<T>(0)) {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_gemv(A, x, y); code != Errc::Ok) throw_error(code);
+        }
+        const std::size_t n = x.size();
+        detail::parallel_for(A.size(), A.size() * n, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                T acc = alpha * detail::dot(A[i].data(), x.data(), n);
+                y[i] = (beta == static_cast<T>(0)) ? acc : acc + beta * y[i];
+            }
+        });
+    }
+
+    template<typename T>
+    std::vector<T> gemv(const MATRIX<T>& A, const std::vector<T>& x) {
+        std::vector<T> y(A.size());
+        gemv(A, x, y);
+        return y;
+    }
+
+    // Transposed matrix-vector product: y = alpha * A^T * x + beta * y
+    template<typename Policy = Checked, typename T>
+    void gemv_transposed(const MATRIX<T>& A, const std::vector<T>& x, std::vector<T>& y,
+                         const T alpha = static_cast<T>(1), const T beta = static_cast<T>(0)) {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_gemv_transposed(A, x, y); code != Errc::Ok) throw_error(code);
+        }
+        // Each thread owns a slice of y and sweeps the rows of A over it, so the
+        // inner loop stays a contiguous axpy and no reduction is needed
+        detail::parallel_for(y.size(), A.size() * y.size(), [&](std::size_t begin, std::size_t end) {
+            T* out = y.data() + begin;
+            const std::size_t len = end - begin;
+            for (std::size_t j = 0; j < len; ++j) out[j] = (beta == static_cast<T>(0)) ? 0 : beta * out[j];
+            for (std::size_t i = 0; i < A.size(); ++i) {
+                detail::axpy(alpha * x[i], A[i].data() + begin, out, len);
+            }
+        });
+    }
+
+    template<typename T>
+    std::vector<T> gemv_transposed(const MATRIX<T>& A, const std::vector<T>& x) {
+        std::vector<T> y(A.empty() ? 0 : A[0].size());
+        gemv_transposed(A, x, y);
+        return y;
+    }
+
+    // Rank-1 update (GER): A += alpha * x * y^T
+    template<typename Policy = Checked, typename T>
+    void ger(MATRIX<T>& A, const std::vector<T>& x, const std::vector<T>& y, const T alpha = static_cast<T>(1)) {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_ger(A, x, y); code != Errc::Ok) throw_error(code);
+        }
+        detail::parallel_for(A.size(), A.size() * y.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                detail::axpy(alpha * x[i], y.data(), A[i].data(), y.size());
+            }
+        });
+    }
+
+    // Symmetric rank-k update (SYRK): C = alpha * A * A^T + beta * C (C must be symmetric when beta != 0)
+    template<typename Policy = Checked, typename T>
+    void syrk(const MATRIX<T>& A, MATRIX<T>& C, const T alpha = static_cast<T>(1), const T beta = static_cast<T>(0)) {
+        if constexpr (Policy::enabled) {
+            if (Errc code = validate_syrk(A, C); code != Errc::Ok) throw_error(code);
+        }
+        const std::size_t n = A.size();
+        const std::size_t k = A[0].size();
+        // Only the lower triangle is computed; each (i, j) pair is mirrored by the
+        // thread that owns row i, so no two threads write the same element. Row i
+        // costs i + 1 dot products, so blocks are cut in triangle elements rather
+        // than rows, or the last block would do (2T - 1) / T^2 of the work.
+        const std::size_t elements = n * (n + 1) / 2;
+        detail::parallel_for(elements, elements * k, [&](std::size_t begin, std::size_t end) {
+            const std::size_t last = detail::triangular_row(end, n);
+            for (std::size_t i = detail::triangular_row(begin, n); i < last; ++i) {
+                for (std::size_t j = 0; j <= i; ++j) {
+                    T acc = alpha * detail::dot(A[i].data(), A[j].data(), k);
+                    if (beta != static_cast<T>(0)) acc += beta * C[i][j];
+                    C[i][j] = acc;
+                    if (j != i) C[j][i] = acc;
+                }
+            }
+        });
+    }
+
+    template<typename T>
+    MATRIX<T> syrk(const MATRIX<T>& A) {
+        MATRIX<T> C(A.size(), std::vector<T>(A.size()));
+        syrk(A, C);
+        return C;
     }
 
 } // namespace algebra
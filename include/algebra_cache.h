@@ -0,0 +1,188 @@
+#ifndef AUT_AP_2024_Spring_HW1_CACHE
+#define AUT_AP_2024_Spring_HW1_CACHE
+
+#include "algebra.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace algebra {
+
+    // Content fingerprint over the shape and the element bytes, consumed eight
+    // bytes at a time in four independent lanes (multiply-xorshift mixing per word)
+    template<typename T>
+    std::uint64_t fingerprint(const MATRIX<T>& matrix) {
+        auto mix = [](std::uint64_t hash, std::uint64_t word) {
+            hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+            return hash ^ (hash >> 31);
+        };
+        std::uint64_t lane[4] = {0x9E3779B97F4A7C15ull, 0xD6E8FEB86659FD93ull, 0xA0761D6478BD642Full, 0xE7037ED1A0B428DBull};
+        lane[0] = mix(lane[0], matrix.size());
+        for (const auto& row : matrix) {
+            const auto* bytes = reinterpret_cast<const unsigned char*>(row.data());
+            const std::size_t size = row.size() * sizeof(T);
+            std::size_t i = 0;
+            for (; i + 32 <= size; i += 32) {
+                std::uint64_t words[4];
+                std::memcpy(words, bytes + i, 32);
+                for (int k = 0; k < 4; ++k) lane[k] = mix(lane[k], words[k]);
+            }
+            for (; i + 8 <= size; i += 8) {
+                std::uint64_t word;
+                std::memcpy(&word, bytes + i, 8);
+                lane[0] = mix(lane[0], word);
+            }
+            std::uint64_t tail = 0;
+            if (i != size) std::memcpy(&tail, bytes + i, size - i);
+            lane[1] = mix(lane[1], tail ^ (std::uint64_t{row.size()} << 8));
+        }
+        return mix(mix(lane[0], lane[1]), mix(lane[2], lane[3]));
+    }
+
+    // Opt-in memoization of determinant and inverse.
+    // A lookup hashes and compares the whole input, so it costs O(n) in the number
+    // of elements: the cache only pays off for operations that cost more than that.
+    // The 2x2 determinant and inverse in this tree are cheaper than a lookup; the
+    // cache is meant for the general-size versions. transpose is not cached since
+    // it costs no more than the copy a lookup would return.
+    // Entries are keyed by content fingerprint, so a modified matrix never hits a
+    // stale result; the old entry simply ages out under the LRU byte budget or can
+    // be dropped eagerly with invalidate(). Lookups take a shared lock and may run
+    // concurrently; only inserts and evictions take the exclusive lock.
+    template<typename T>
+    class ResultCache {
+    public:
+        explicit ResultCache(std::size_t budget_bytes = std::size_t{64} << 20) : budget_(budget_bytes) {}
+
+        double determinant(const MATRIX<T>& matrix) {
+            return lookup(matrix, &Entry::det, [](const MATRIX<T>& m) { return algebra::determinant(m); });
+        }
+
+        // Shared with the cache and never copied on a hit; it stays valid after
+        // the entry is evicted
+        std::shared_ptr<const MATRIX<double>> inverse(const MATRIX<T>& matrix) {
+            return lookup(matrix, &Entry::inv, [](const MATRIX<T>& m) {
+                return std::make_shared<const MATRIX<double>>(algebra::inverse(m));
+            });
+        }
+
+        // Drop every cached result computed from this content
+        void invalidate(const MATRIX<T>& matrix) {
+            const std::uint64_t key = fingerprint(matrix);
+            std::unique_lock lock(mutex_);
+            auto it = entries_.find(key);
+            if (it != entries_.end() && it->second->input == matrix) {
+                bytes_ -= it->second->bytes;
+                entries_.erase(it);
+            }
+        }
+
+        void clear() {
+            std::unique_lock lock(mutex_);
+            entries_.clear();
+            bytes_ = 0;
+        }
+
+        std::size_t size_bytes() const {
+            std::shared_lock lock(mutex_);
+            return bytes_;
+        }
+
+        std::size_t hits() const { return hits_.load(std::memory_order_relaxed); }
+        std::size_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+    private:
+        struct Entry {
+            MATRIX<T> input;
+            std::optional<double> det;
+            std::optional<std::shared_ptr<const MATRIX<double>>> inv;
+            std::size_t bytes = 0;
+            std::atomic<std::uint64_t> last_used{0};
+        };
+
+        template<typename U>
+        static std::size_t footprint(const MATRIX<U>& matrix) {
+            std::size_t bytes = sizeof(matrix);
+            for (const auto& row : matrix) bytes += sizeof(row) + row.size() * sizeof(U);
+            return bytes;
+        }
+
+        static std::size_t footprint(double) { return sizeof(double); }
+
+        static std::size_t footprint(const std::shared_ptr<const MATRIX<double>>& result) {
+            return footprint(*result);
+        }
+
+        template<typename R, typename Compute>
+        R lookup(const MATRIX<T>& matrix, std::optional<R> Entry::*slot, Compute compute) {
+            const std::uint64_t key = fingerprint(matrix);
+            {
+                std::shared_lock lock(mutex_);
+                auto it = entries_.find(key);
+                if (it != entries_.end() && (*it->second).*slot && it->second->input == matrix) {
+                    it->second->last_used.store(++clock_, std::memory_order_relaxed);
+                    hits_.fetch_add(1, std::memory_order_relaxed);
+                    return *((*it->second).*slot);
+                }
+            }
+            misses_.fetch_add(1, std::memory_order_relaxed);
+
+            // Computed outside the lock; failures propagate and are not cached
+            R result = compute(matrix);
+
+            std::unique_lock lock(mutex_);
+            auto& entry = entries_[key];
+            if (!entry || entry->input != matrix) {
+                // New content, or a fingerprint collision: replace the old entry
+                if (entry) bytes_ -= entry->bytes;
+                entry = std::make_unique<Entry>();
+                entry->input = matrix;
+                entry->bytes = footprint(matrix);
+                bytes_ += entry->bytes;
+            }
+            if (!((*entry).*slot)) {
+                const std::size_t added = footprint(result);
+                (*entry).*slot = result;
+                entry->bytes += added;
+                bytes_ += added;
+            }
+            entry->last_used.store(++clock_, std::memory_order_relaxed);
+            evict(key);
+            return result;
+        }
+
+        // Evict least recently used entries until the budget is met; the entry
+        // that was just touched is kept even if it alone exceeds the budget
+        void evict(std::uint64_t keep) {
+            if (bytes_ <= budget_) return;
+            std::vector<std::pair<std::uint64_t, std::uint64_t>> order;
+            order.reserve(entries_.size());
+            for (const auto& [key, entry] : entries_) {
+                if (key != keep) order.emplace_back(entry->last_used.load(std::memory_order_relaxed), key);
+            }
+            std::sort(order.begin(), order.end());
+            for (const auto& [stamp, key] : order) {
+                if (bytes_ <= budget_) break;
+                auto it = entries_.find(key);
+                bytes_ -= it->second->bytes;
+                entries_.erase(it);
+            }
+        }
+
+        std::size_t budget_;
+        std::size_t bytes_ = 0;
+        std::unordered_map<std::uint64_t, std::unique_ptr<Entry>> entries_;
+        mutable std::shared_mutex mutex_;
+        std::atomic<std::uint64_t> clock_{0};
+        std::atomic<std::size_t> hits_{0};
+        std::atomic<std::size_t> misses_{0};
+    };
+
+} // namespace algebra
+
+#endif //AUT_AP_2024_Spring_HW1_CACHE
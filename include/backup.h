@@ -0,0 +1,127 @@
+#ifndef AUT_AP_2024_Spring_HW1_BACKUP
+#define AUT_AP_2024_Spring_HW1_BACKUP
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace backup {
+
+    namespace fs = std::filesystem;
+
+    // One file or directory found under the source tree
+    struct FileEntry {
+        std::string name;           // archive path, relative to the parent of the source directory
+        fs::path path;              // location on disk
+        bool is_directory = false;
+        std::uintmax_t size = 0;
+        std::int64_t mtime = 0;     // nanoseconds since the filesystem clock epoch
+        std::uint32_t crc = 0;      // CRC-32 of the content, filled in once the file has been read
+        std::string digest;         // content digest for --checksum (see content_digest), empty if unknown
+        std::uint32_t mode = 0;     // POSIX permission bits
+        bool skipped = false;       // unreadable: a file is left out of the archive and the manifest,
+                                    // a directory is archived without its contents
+    };
+
+    // Last known state of every file, keyed by archive path
+    using Manifest = std::unordered_map<std::string, FileEntry>;
+
+    // How unchanged files are detected in incremental mode
+    enum class ChangeDetection { None, Mtime, Checksum };
+
+    struct Options {
+        fs::path source;
+        fs::path destination;
+        int compression_level = 1;
+        ChangeDetection detection = ChangeDetection::None;
+        unsigned threads = 0;                       // 0 = std::thread::hardware_concurrency()
+        std::size_t chunk_size = std::size_t{1} << 20;
+        std::size_t batch_bytes = std::size_t{64} << 20;  // input compressed (and output held) per window
+        bool deduplicate = false;                   // write to the chunk store instead of a zip (chunk_store.h)
+    };
+
+    struct Report {
+        std::string date;
+        std::string start_time;
+        std::string end_time;
+        std::string machine;
+        fs::path archive;
+        std::size_t files_backed_up = 0;
+        std::size_t files_skipped = 0;
+        std::size_t directories = 0;
+        std::uintmax_t bytes_read = 0;
+        std::uintmax_t bytes_written = 0;
+        std::size_t chunks = 0;                     // deduplicating store only
+        std::size_t chunks_new = 0;
+        double seconds = 0;
+        std::vector<std::string> warnings;          // entries skipped because they could not be read
+        std::vector<std::string> deleted;           // incremental only: files gone since the previous run
+    };
+
+    namespace detail {
+        unsigned worker_count(unsigned requested);
+
+        // Absolute, normalized source directory without a trailing separator
+        fs::path source_directory(const fs::path& root);
+
+        std::string format_utc(std::chrono::system_clock::time_point time, const char* format);
+        std::string machine_information();
+
+        // Hex SHA-256 over the SHA-256 of each chunk_size slice of a file (a hash
+        // list, so write_zip can hash chunks concurrently). An empty file is one
+        // empty slice. Throws if the file cannot be read.
+        std::string content_digest(const fs::path& file, std::size_t chunk_size);
+
+        // Run fn(worker_index) on `threads` workers and rethrow the first failure
+        template<typename Fn>
+        void run_workers(unsigned threads, Fn fn) {
+            std::vector<std::thread> pool;
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            auto guarded = [&](unsigned index) {
+                try {
+                    fn(index);
+                } catch (...) {
+                    std::lock_guard lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                }
+            };
+            for (unsigned i = 1; i < threads; ++i) pool.emplace_back(guarded, i);
+            guarded(0);
+            for (auto& t : pool) t.join();
+            if (error) std::rethrow_exception(error);
+        }
+    } // namespace detail
+
+    // Walk the tree rooted at `root` with `threads` workers; entries are sorted by name.
+    // Subdirectories and files that cannot be read are skipped like zip(1) does and
+    // described in `warnings` when it is given; only an unreadable root throws.
+    std::vector<FileEntry> scan_tree(const fs::path& root, unsigned threads,
+                                     std::vector<std::string>* warnings = nullptr);
+
+    Manifest load_manifest(const fs::path& file);
+    void save_manifest(const fs::path& file, const std::vector<FileEntry>& entries);
+
+    // Write `entries` to a zip archive at `archive`, compressing chunks concurrently.
+    // CRCs of the written files, and their digests unless options.detection is
+    // Mtime, are stored back into `entries`. A file that cannot be
+    // read in full is left out, marked `skipped` and described in `warnings`.
+    // Returns the archive size.
+    std::uintmax_t write_zip(const fs::path& archive, std::vector<FileEntry>& entries, const Options& options,
+                             std::vector<std::string>* warnings = nullptr);
+
+    // Run a full or incremental backup and return what was done
+    Report run_backup(const Options& options);
+
+    // Write the backup_log.txt report
+    void write_log(const fs::path& file, const Options& options, const Report& report);
+
+} // namespace backup
+
+#endif //AUT_AP_2024_Spring_HW1_BACKUP
@@ -0,0 +1,44 @@
+#ifndef AUT_AP_2024_Spring_HW1_CHUNK_STORE
+#define AUT_AP_2024_Spring_HW1_CHUNK_STORE
+
+#include "backup.h"
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace backup {
+
+    // Content-defined chunk size limits; cut points depend only on nearby bytes,
+    // so an insertion early in a file does not shift the chunks after it
+    struct ChunkLimits {
+        std::size_t min = std::size_t{16} << 10;
+        std::size_t average = std::size_t{64} << 10;   // must be a power of two
+        std::size_t max = std::size_t{256} << 10;
+    };
+
+    // Lowercase hex SHA-256 digest, the address of a chunk in the store
+    std::string sha256_hex(const void* data, std::size_t size);
+
+    // Split a stream into content-defined chunks (gear rolling hash) and call
+    // fn(data, size) for each one, buffering at most 2 * limits.max bytes.
+    // Throws std::ios_base::failure if the stream goes bad before its end.
+    void split_chunks(std::istream& in, const ChunkLimits& limits,
+                      const std::function<void(const char* data, std::size_t size)>& fn);
+
+    // Store layout under <destination>/<directoryname>.store/:
+    //   packs/<snapshot>.pack   zlib-compressed chunks appended by one run
+    //   index                   "hash pack offset stored_size raw_size" per chunk
+    //   snapshots/<snapshot>    per-file metadata and the ordered chunk hashes
+    // Files whose size and mtime match the previous snapshot reuse its chunk list
+    // without being read when options.detection is Mtime.
+    Report run_dedup_backup(const Options& options);
+
+    // Stream one file of a snapshot to `out` without unpacking anything else
+    void restore_file(const fs::path& store, const fs::path& snapshot, const std::string& name, std::ostream& out);
+
+} // namespace backup
+
+#endif //AUT_AP_2024_Spring_HW1_CHUNK_STORE
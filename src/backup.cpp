@@ -0,0 +1,754 @@
+#include "backup.h"
+#include "chunk_store.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+#include <sys/utsname.h>
+
+namespace backup {
+
+    namespace detail {
+
+        unsigned worker_count(unsigned requested) {
+            if (requested != 0) return requested;
+            return std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        std::string format_utc(std::chrono::system_clock::time_point time, const char* format) {
+            std::time_t t = std::chrono::system_clock::to_time_t(time);
+            std::tm tm{};
+            gmtime_r(&t, &tm);
+            std::ostringstream out;
+            out << std::put_time(&tm, format);
+            return out.str();
+        }
+
+        fs::path source_directory(const fs::path& root) {
+            fs::path top = fs::absolute(root).lexically_normal();
+            return top.has_filename() ? top : top.parent_path();
+        }
+
+        std::string content_digest(const fs::path& file, std::size_t chunk_size) {
+            std::ifstream in(file, std::ios::binary);
+            if (!in) throw std::runtime_error("Cannot open " + file.string());
+            std::vector<char> buffer(chunk_size);
+            std::string digests;
+            while (in.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || in.gcount() > 0) {
+                digests += sha256_hex(buffer.data(), static_cast<std::size_t>(in.gcount()));
+            }
+            if (in.bad()) throw std::runtime_error("Cannot read " + file.string());
+            if (digests.empty()) digests = sha256_hex("", 0);
+            return sha256_hex(digests.data(), digests.size());
+        }
+
+        std::string machine_information() {
+            utsname info{};
+            if (uname(&info) != 0) return "unknown";
+            std::ostringstream out;
+            out << info.sysname << ' ' << info.nodename << ' ' << info.release << ' ' << info.version << ' ' << info.machine;
+            return out.str();
+        }
+
+    } // namespace detail
+
+    namespace {
+
+        using detail::run_workers;
+        using detail::worker_count;
+        using detail::source_directory;
+        using detail::format_utc;
+        using detail::content_digest;
+        using detail::machine_information;
+
+        // ----------------------------------------------------------------
+        // Zip container
+        // ----------------------------------------------------------------
+
+        constexpr std::uint32_t zip64_marker = 0xFFFFFFFFu;
+        constexpr std::uint64_t zip64_threshold = 0xF0000000u;
+        constexpr std::size_t deflate_window = 32 * 1024;
+
+        void put16(std::string& out, std::uint16_t v) {
+            out.push_back(static_cast<char>(v & 0xFF));
+            out.push_back(static_cast<char>(v >> 8));
+        }
+
+        void put32(std::string& out, std::uint32_t v) {
+            put16(out, static_cast<std::uint16_t>(v & 0xFFFF));
+            put16(out, static_cast<std::uint16_t>(v >> 16));
+        }
+
+        void put64(std::string& out, std::uint64_t v) {
+            put32(out, static_cast<std::uint32_t>(v & 0xFFFFFFFFu));
+            put32(out, static_cast<std::uint32_t>(v >> 32));
+        }
+
+        // MS-DOS date and time fields, in local time like zip(1)
+        std::pair<std::uint16_t, std::uint16_t> dos_datetime(std::int64_t mtime) {
+            auto file_time = fs::file_time_type(fs::file_time_type::duration(mtime));
+            auto sys_time = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+                fs::file_time_type::clock::to_sys(file_time));
+            std::time_t t = std::chrono::system_clock::to_time_t(sys_time);
+            std::tm tm{};
+            localtime_r(&t, &tm);
+            if (tm.tm_year < 80) return {0, (1 << 5) | 1};
+            auto time = static_cast<std::uint16_t>((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+            auto date = static_cast<std::uint16_t>(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+            return {time, date};
+        }
+
+        struct CentralRecord {
+            const FileEntry* entry;
+            std::uint16_t method;
+            std::uint64_t compressed;
+            std::uint64_t offset;
+        };
+
+        class ZipWriter {
+        public:
+            explicit ZipWriter(const fs::path& file) : file_(file), out_(file, std::ios::binary | std::ios::trunc) {
+                if (!out_) throw std::runtime_error("Cannot create archive " + file.string());
+            }
+
+            // Local header for an entry whose data follows; its CRC and sizes are
+            // patched in by end() once the data has been streamed out
+            void begin(const FileEntry& entry, std::uint16_t method) {
+                // Deflate may expand incompressible data slightly, so reserve ZIP64
+                // fields well before the 4 GiB limit
+                pending_zip64_ = entry.size >= zip64_threshold;
+                std::string extra;
+                if (pending_zip64_) {
+                    put16(extra, 0x0001);
+                    put16(extra, 16);
+                    put64(extra, 0);
+                    put64(extra, 0);
+                }
+                auto [time, date] = dos_datetime(entry.mtime);
+                std::string header;
+                put32(header, 0x04034b50);
+                put16(header, pending_zip64_ ? 45 : 20);
+                put16(header, 0x0800);
+                put16(header, method);
+                put16(header, time);
+                put16(header, date);
+                put32(header, 0);
+                put32(header, pending_zip64_ ? zip64_marker : 0);
+                put32(header, pending_zip64_ ? zip64_marker : 0);
+                put16(header, static_cast<std::uint16_t>(entry.name.size()));
+                put16(header, static_cast<std::uint16_t>(extra.size()));
+                header += entry.name;
+                header += extra;
+                pending_ = {&entry, method, 0, offset_};
+                write(header);
+            }
+
+            void end(std::uint64_t compressed) {
+                const FileEntry& entry = *pending_.entry;
+                if (!pending_zip64_ && (compressed >= zip64_marker || entry.size >= zip64_marker)) {
+                    throw std::runtime_error("Entry outgrew its header: " + entry.name);
+                }
+                std::string fields;
+                put32(fields, entry.crc);
+                if (!pending_zip64_) {
+                    put32(fields, static_cast<std::uint32_t>(compressed));
+                    put32(fields, static_cast<std::uint32_t>(entry.size));
+                }
+                patch(pending_.offset + 14, fields);
+                if (pending_zip64_) {
+                    fields.clear();
+                    put64(fields, entry.size);
+                    put64(fields, compressed);
+                    patch(pending_.offset + 30 + entry.name.size() + 4, fields);
+                }
+                pending_.compressed = compressed;
+                records_.push_back(pending_);
+            }
+
+            // Drop the entry begun last; whatever follows overwrites its bytes
+            void abandon() {
+                offset_ = pending_.offset;
+                out_.seekp(static_cast<std::streamoff>(offset_));
+                truncate_ = true;
+            }
+
+            void write(const std::string& data) {
+                out_.write(data.data(), static_cast<std::streamsize>(data.size()));
+                if (!out_) throw std::runtime_error("Write to archive failed.");
+                offset_ += data.size();
+            }
+
+            std::uint64_t finish() {
+                const std::uint64_t directory_offset = offset_;
+                for (const auto& record : records_) write(central_header(record));
+                const std::uint64_t directory_size = offset_ - directory_offset;
+                const std::uint64_t count = records_.size();
+
+                std::string tail;
+                if (count >= 0xFFFF || directory_offset >= zip64_marker || directory_size >= zip64_marker) {
+                    const std::uint64_t zip64_end = offset_;
+                    put32(tail, 0x06064b50);
+                    put64(tail, 44);
+                    put16(tail, (3 << 8) | 45);
+                    put16(tail, 45);
+                    put32(tail, 0);
+                    put32(tail, 0);
+                    put64(tail, count);
+                    put64(tail, count);
+                    put64(tail, directory_size);
+                    put64(tail, directory_offset);
+                    put32(tail, 0x07064b50);
+                    put32(tail, 0);
+                    put64(tail, zip64_end);
+                    put32(tail, 1);
+                }
+                put32(tail, 0x06054b50);
+                put16(tail, 0);
+                put16(tail, 0);
+                put16(tail, static_cast<std::uint16_t>(std::min<std::uint64_t>(count, 0xFFFF)));
+                put16(tail, static_cast<std::uint16_t>(std::min<std::uint64_t>(count, 0xFFFF)));
+                put32(tail, static_cast<std::uint32_t>(std::min<std::uint64_t>(directory_size, zip64_marker)));
+                put32(tail, static_cast<std::uint32_t>(std::min<std::uint64_t>(directory_offset, zip64_marker)));
+                put16(tail, 0);
+                write(tail);
+                out_.close();
+                if (!out_) throw std::runtime_error("Closing archive failed.");
+                if (truncate_) fs::resize_file(file_, offset_);
+                return offset_;
+            }
+
+        private:
+            void patch(std::uint64_t position, const std::string& data) {
+                out_.seekp(static_cast<std::streamoff>(position));
+                out_.write(data.data(), static_cast<std::streamsize>(data.size()));
+                out_.seekp(static_cast<std::streamoff>(offset_));
+                if (!out_) throw std::runtime_error("Write to archive failed.");
+            }
+
+            static std::string central_header(const CentralRecord& record) {
+                const FileEntry& entry = *record.entry;
+                std::string extra;
+                std::string fields;
+                if (entry.size >= zip64_marker) put64(fields, entry.size);
+                if (record.compressed >= zip64_marker) put64(fields, record.compressed);
+                if (record.offset >= zip64_marker) put64(fields, record.offset);
+                if (!fields.empty()) {
+                    put16(extra, 0x0001);
+                    put16(extra, static_cast<std::uint16_t>(fields.size()));
+                    extra += fields;
+                }
+                const std::uint32_t unix_mode = (entry.is_directory ? 0040000u : 0100000u) | (entry.mode & 07777u);
+                auto [time, date] = dos_datetime(entry.mtime);
+                std::string header;
+                put32(header, 0x02014b50);
+                put16(header, (3 << 8) | 45);
+                put16(header, extra.empty() ? 20 : 45);
+                put16(header, 0x0800);
+                put16(header, record.method);
+                put16(header, time);
+                put16(header, date);
+                put32(header, entry.crc);
+                put32(header, static_cast<std::uint32_t>(std::min<std::uint64_t>(record.compressed, zip64_marker)));
+                put32(header, static_cast<std::uint32_t>(std::min<std::uint64_t>(entry.size, zip64_marker)));
+                put16(header, static_cast<std::uint16_t>(entry.name.size()));
+                put16(header, static_cast<std::uint16_t>(extra.size()));
+                put16(header, 0);
+                put16(header, 0);
+                put16(header, 0);
+                put32(header, (unix_mode << 16) | (entry.is_directory ? 0x10u : 0u));
+                put32(header, static_cast<std::uint32_t>(std::min<std::uint64_t>(record.offset, zip64_marker)));
+                header += entry.name;
+                header += extra;
+                return header;
+            }
+
+            fs::path file_;
+            std::ofstream out_;
+            std::uint64_t offset_ = 0;
+            std::vector<CentralRecord> records_;
+            CentralRecord pending_{};
+            bool pending_zip64_ = false;
+            bool truncate_ = false;     // an abandoned entry may have left bytes past the end
+        };
+
+        // ----------------------------------------------------------------
+        // Chunked compression
+        // ----------------------------------------------------------------
+
+        // A slice of one file, compressed independently of the others. Chunks of the
+        // same file are primed with the previous 32 KiB as a preset dictionary and
+        // sync-flushed, so their raw deflate streams concatenate into one valid stream.
+        struct Chunk {
+            std::size_t file;
+            std::uint64_t offset;
+            std::size_t length;
+            bool last;
+            std::string data;
+            std::uint32_t crc = 0;
+            std::string digest;         // SHA-256 of the slice, when digests are wanted
+            std::string error;          // why the file could not be read, if it could not
+        };
+
+        std::string read_range(const fs::path& path, std::uint64_t offset, std::size_t length) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) throw std::runtime_error("Cannot open " + path.string());
+            std::string buffer(length, '\0');
+            in.seekg(static_cast<std::streamoff>(offset));
+            in.read(buffer.data(), static_cast<std::streamsize>(length));
+            if (static_cast<std::size_t>(in.gcount()) != length) {
+                throw std::runtime_error("File changed while being backed up: " + path.string());
+            }
+            return buffer;
+        }
+
+        void compress_chunk(Chunk& chunk, const FileEntry& entry, int level, bool digest) {
+            const std::size_t history = std::min<std::uint64_t>(chunk.offset, deflate_window);
+            std::string input = read_range(entry.path, chunk.offset - history, history + chunk.length);
+            const auto* data = reinterpret_cast<const Bytef*>(input.data()) + history;
+            chunk.crc = static_cast<std::uint32_t>(crc32(0L, data, static_cast<uInt>(chunk.length)));
+            if (digest) chunk.digest = sha256_hex(data, chunk.length);
+
+            if (level == 0) {
+                chunk.data.assign(input, history, chunk.length);
+                return;
+            }
+
+            z_stream stream{};
+            if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                throw std::runtime_error("deflateInit2 failed.");
+            }
+            if (history != 0) {
+                deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(input.data()), static_cast<uInt>(history));
+            }
+            chunk.data.resize(deflateBound(&stream, static_cast<uLong>(chunk.length)) + 16);
+            stream.next_in = const_cast<Bytef*>(data);
+            stream.avail_in = static_cast<uInt>(chunk.length);
+            stream.next_out = reinterpret_cast<Bytef*>(chunk.data.data());
+            stream.avail_out = static_cast<uInt>(chunk.data.size());
+            int status = deflate(&stream, chunk.last ? Z_FINISH : Z_SYNC_FLUSH);
+            const bool ok = chunk.last ? status == Z_STREAM_END : status == Z_OK && stream.avail_in == 0;
+            chunk.data.resize(stream.total_out);
+            deflateEnd(&stream);
+            if (!ok) throw std::runtime_error("deflate failed for " + entry.path.string());
+        }
+
+    } // namespace
+
+    std::vector<FileEntry> scan_tree(const fs::path& root, unsigned threads, std::vector<std::string>* warnings) {
+        if (!fs::is_directory(root)) throw std::runtime_error("Source path is not a directory: " + root.string());
+        const fs::path top = source_directory(root);
+        const fs::path parent = top.parent_path();
+
+        auto make_entry = [&parent](const fs::directory_entry& item, bool directory) {
+            FileEntry entry;
+            entry.path = item.path();
+            entry.is_directory = directory;
+            entry.name = item.path().lexically_relative(parent).generic_string() + (directory ? "/" : "");
+            entry.size = directory ? 0 : item.file_size();
+            entry.mtime = item.last_write_time().time_since_epoch().count();
+            entry.mode = static_cast<std::uint32_t>(item.status().permissions());
+            return entry;
+        };
+
+        std::vector<FileEntry> entries{make_entry(fs::directory_entry(top), true)};
+        std::vector<fs::path> level{top};
+        std::vector<fs::path> unlisted;
+        std::mutex mutex;
+
+        // Breadth-first: the directories of one level are listed concurrently and
+        // their subdirectories form the next level
+        while (!level.empty()) {
+            std::vector<fs::path> next_level;
+            std::atomic<std::size_t> cursor{0};
+            run_workers(std::min<std::size_t>(worker_count(threads), level.size()), [&](unsigned) {
+                std::vector<FileEntry> local;
+                std::vector<fs::path> found;
+                std::vector<std::string> problems;
+                std::vector<fs::path> failed;
+                for (std::size_t i = cursor++; i < level.size(); i = cursor++) {
+                    std::error_code error;
+                    fs::directory_iterator it(level[i], error);
+                    for (; !error && it != fs::directory_iterator(); it.increment(error)) {
+                        try {
+                            if (it->is_directory() && !it->is_symlink()) {
+                                local.push_back(make_entry(*it, true));
+                                found.push_back(it->path());
+                            } else if (it->is_regular_file()) {
+                                local.push_back(make_entry(*it, false));
+                            }
+                        } catch (const fs::filesystem_error& e) {
+                            problems.push_back("Cannot read " + it->path().string() + ": " + e.code().message());
+                        }
+                    }
+                    if (error) {
+                        problems.push_back("Cannot read " + level[i].string() + ": " + error.message());
+                        failed.push_back(level[i]);
+                    }
+                }
+                std::lock_guard lock(mutex);
+                entries.insert(entries.end(), std::make_move_iterator(local.begin()), std::make_move_iterator(local.end()));
+                next_level.insert(next_level.end(), found.begin(), found.end());
+                unlisted.insert(unlisted.end(), failed.begin(), failed.end());
+                if (warnings) warnings->insert(warnings->end(), problems.begin(), problems.end());
+            });
+            level = std::move(next_level);
+        }
+
+        // A directory that could not be listed is still archived, but marked so
+        // callers do not take its missing contents for deletions
+        for (const auto& path : unlisted) {
+            if (path == top) throw std::runtime_error("Cannot read source directory " + top.string());
+            for (auto& entry : entries) {
+                if (entry.path == path) entry.skipped = true;
+            }
+        }
+
+        std::sort(entries.begin(), entries.end(),
+                  [](const FileEntry& a, const FileEntry& b) { return a.name < b.name; });
+        if (warnings) std::sort(warnings->begin(), warnings->end());
+        return entries;
+    }
+
+    Manifest load_manifest(const fs::path& file) {
+        Manifest manifest;
+        std::ifstream in(file);
+        if (!in) return manifest;
+        std::string line;
+        bool v1 = false;            // v1 manifests have no digest column
+        while (std::getline(in, line)) {
+            if (line.rfind("# backup manifest v1", 0) == 0) v1 = true;
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream fields(line);
+            FileEntry entry;
+            fields >> entry.crc >> entry.size >> entry.mtime;
+            if (!v1) {
+                fields >> entry.digest;
+                if (entry.digest == "-") entry.digest.clear();
+            }
+            if (!fields || fields.get() != '\t') throw std::runtime_error("Corrupt manifest: " + file.string());
+            std::getline(fields, entry.name);
+            manifest.emplace(entry.name, entry);
+        }
+        return manifest;
+    }
+
+    void save_manifest(const fs::path& file, const std::vector<FileEntry>& entries) {
+        const fs::path temporary = file.string() + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            out << "# backup manifest v2: crc32 size mtime sha256 name\n";
+            for (const auto& entry : entries) {
+                if (entry.is_directory || entry.skipped) continue;
+                out << entry.crc << ' ' << entry.size << ' ' << entry.mtime << ' '
+                    << (entry.digest.empty() ? "-" : entry.digest) << '\t' << entry.name << '\n';
+            }
+            if (!out) throw std::runtime_error("Cannot write manifest " + file.string());
+        }
+        fs::rename(temporary, file);
+    }
+
+    std::uintmax_t write_zip(const fs::path& archive, std::vector<FileEntry>& entries, const Options& options,
+                             std::vector<std::string>* warnings) {
+        const unsigned threads = worker_count(options.threads);
+        const int level = std::clamp(options.compression_level, 0, 9);
+        const std::uint16_t method = level == 0 ? 0 : 8;
+        const std::size_t chunk_size = std::max<std::size_t>(options.chunk_size, deflate_window);
+        // Hashing costs about as much CPU as level-1 deflate, so mtime-only runs,
+        // which never compare contents, skip it
+        const bool digests = options.detection != ChangeDetection::Mtime;
+
+        ZipWriter zip(archive);
+        // Windows of chunks are cut at chunk granularity, so a large file spans several
+        // windows and at most batch_bytes of input is compressed and held at a time.
+        // Each file's chunks are written in order as their window completes.
+        std::size_t file = 0;
+        std::uint64_t offset = 0;
+        std::uint32_t crc = 0;
+        std::uint64_t compressed = 0;
+        std::string chunk_digests;
+        while (file < entries.size()) {
+            std::vector<Chunk> window;
+            std::uintmax_t window_bytes = 0;
+            while (file < entries.size() && (window.empty() || window_bytes < options.batch_bytes)) {
+                const FileEntry& entry = entries[file];
+                if (entry.is_directory) {
+                    window.push_back({file++, 0, 0, true, {}, 0, {}, {}});
+                    continue;
+                }
+                std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(chunk_size, entry.size - offset));
+                const bool last = offset + length == entry.size;
+                window.push_back({file, offset, length, last, {}, 0, {}, {}});
+                window_bytes += length;
+                offset += length;
+                if (last) {
+                    ++file;
+                    offset = 0;
+                }
+            }
+
+            std::atomic<std::size_t> cursor{0};
+            run_workers(std::min<std::size_t>(threads, window.size()), [&](unsigned) {
+                for (std::size_t i = cursor++; i < window.size(); i = cursor++) {
+                    const FileEntry& entry = entries[window[i].file];
+                    if (entry.is_directory || entry.skipped) continue;
+                    try {
+                        compress_chunk(window[i], entry, level, digests);
+                    } catch (const std::exception& e) {
+                        window[i].error = e.what();
+                    }
+                }
+            });
+
+            for (auto& chunk : window) {
+                FileEntry& entry = entries[chunk.file];
+                if (entry.is_directory) {
+                    entry.crc = 0;
+                    zip.begin(entry, 0);
+                    zip.end(0);
+                    continue;
+                }
+                if (entry.skipped) continue;
+                if (!chunk.error.empty()) {
+                    // Like zip(1), leave the file out and carry on with the rest
+                    if (chunk.offset != 0) zip.abandon();
+                    entry.skipped = true;
+                    if (warnings) warnings->push_back(chunk.error);
+                    continue;
+                }
+                if (chunk.offset == 0) {
+                    zip.begin(entry, method);
+                    crc = 0;
+                    compressed = 0;
+                    chunk_digests.clear();
+                }
+                zip.write(chunk.data);
+                compressed += chunk.data.size();
+                crc = static_cast<std::uint32_t>(crc32_combine(crc, chunk.crc, static_cast<z_off_t>(chunk.length)));
+                std::string().swap(chunk.data);
+                chunk_digests += chunk.digest;
+                if (chunk.last) {
+                    entry.crc = crc;
+                    entry.digest = digests ? sha256_hex(chunk_digests.data(), chunk_digests.size()) : std::string();
+                    zip.end(compressed);
+                }
+            }
+        }
+        return zip.finish();
+    }
+
+    Report run_backup(const Options& options) {
+        Report report;
+        const auto start = std::chrono::system_clock::now();
+        const auto start_clock = std::chrono::steady_clock::now();
+        report.date = format_utc(start, "%Y-%m-%d");
+        report.start_time = format_utc(start, "%H:%M:%S");
+        report.machine = machine_information();
+
+        fs::create_directories(options.destination);
+        std::vector<FileEntry> entries = scan_tree(options.source, options.threads, &report.warnings);
+        const std::string directory_name = source_directory(options.source).filename().string();
+        const fs::path manifest_file = options.destination / ("." + directory_name + ".manifest");
+        const bool incremental = options.detection != ChangeDetection::None;
+
+        const Manifest previous = incremental ? load_manifest(manifest_file) : Manifest{};
+
+        // An incremental archive only holds what exists, so files that disappeared
+        // since the manifest was written are listed beside it; otherwise rebuilding
+        // from the full backup and its incrementals would bring them back
+        std::vector<FileEntry> unlisted;
+        if (incremental) {
+            std::unordered_set<std::string> present;
+            std::vector<std::string> hidden;
+            for (const auto& entry : entries) {
+                present.insert(entry.name);
+                if (entry.is_directory && entry.skipped) hidden.push_back(entry.name);
+            }
+            for (const auto& [name, entry] : previous) {
+                if (present.count(name)) continue;
+                // Files of a directory that could not be listed are unknown, not deleted
+                const bool unknown = std::any_of(hidden.begin(), hidden.end(), [&name](const std::string& directory) {
+                    return name.compare(0, directory.size(), directory) == 0;
+                });
+                if (unknown) {
+                    unlisted.push_back(entry);
+                } else {
+                    report.deleted.push_back(name);
+                }
+            }
+            std::sort(report.deleted.begin(), report.deleted.end());
+        }
+
+        // Decide which files changed since the manifest was written
+        std::vector<FileEntry> changed;
+        if (incremental) {
+            std::vector<std::size_t> candidates;
+            for (std::size_t i = 0; i < entries.size(); ++i) {
+                auto& entry = entries[i];
+                if (entry.is_directory) continue;
+                auto it = previous.find(entry.name);
+                if (it == previous.end() || it->second.size != entry.size) {
+                    changed.push_back(entry);
+                } else if (options.detection == ChangeDetection::Mtime && it->second.mtime == entry.mtime) {
+                    entry.crc = it->second.crc;
+                    entry.digest = it->second.digest;
+                } else {
+                    candidates.push_back(i);
+                }
+            }
+            if (options.detection == ChangeDetection::Mtime) {
+                for (auto i : candidates) changed.push_back(entries[i]);
+            } else {
+                // Checksum mode re-reads same-sized files and compares SHA-256 digests.
+                // A file without a recorded digest (archived by an mtime-only run) or
+                // that cannot be read counts as changed.
+                std::atomic<std::size_t> cursor{0};
+                std::vector<char> differs(candidates.size(), 0);
+                const std::size_t chunk_size = std::max<std::size_t>(options.chunk_size, deflate_window);
+                run_workers(worker_count(options.threads), [&](unsigned) {
+                    for (std::size_t k = cursor++; k < candidates.size(); k = cursor++) {
+                        auto& entry = entries[candidates[k]];
+                        const FileEntry& old = previous.at(entry.name);
+                        std::string digest;
+                        try {
+                            digest = content_digest(entry.path, chunk_size);
+                        } catch (const std::exception&) {
+                            differs[k] = 1;
+                            continue;
+                        }
+                        differs[k] = old.digest.empty() || digest != old.digest;
+                        if (!differs[k]) {
+                            entry.crc = old.crc;
+                            entry.digest = old.digest;
+                        }
+                    }
+                });
+                for (std::size_t k = 0; k < candidates.size(); ++k) {
+                    if (differs[k]) changed.push_back(entries[candidates[k]]);
+                }
+            }
+            std::sort(changed.begin(), changed.end(),
+                      [](const FileEntry& a, const FileEntry& b) { return a.name < b.name; });
+        }
+
+        std::vector<FileEntry>& archived = incremental ? changed : entries;
+        // A full backup replaces the day's archive like the script does. Incrementals
+        // are never overwritten: each one holds changes no other archive has.
+        report.archive = options.destination / (report.date + "_" + directory_name + ".zip");
+        if (incremental) {
+            const std::string stem = report.date + "_" + directory_name + "_incremental_" + format_utc(start, "%H%M%S");
+            report.archive = options.destination / (stem + ".zip");
+            for (int n = 2; fs::exists(report.archive); ++n) {
+                report.archive = options.destination / (stem + "-" + std::to_string(n) + ".zip");
+            }
+        }
+        const fs::path temporary = report.archive.string() + ".tmp";
+        report.bytes_written = write_zip(temporary, archived, options, &report.warnings);
+        fs::rename(temporary, report.archive);
+
+        if (!report.deleted.empty()) {
+            const fs::path list = fs::path(report.archive).replace_extension(".deleted");
+            const fs::path list_temporary = list.string() + ".tmp";
+            {
+                std::ofstream out(list_temporary, std::ios::trunc);
+                for (const auto& name : report.deleted) out << name << '\n';
+                if (!out) throw std::runtime_error("Cannot write deletion list " + list.string());
+            }
+            fs::rename(list_temporary, list);
+        }
+
+        std::size_t unreadable = 0;
+        for (const auto& entry : entries) {
+            if (entry.is_directory) ++report.directories;
+        }
+        for (const auto& entry : archived) {
+            if (entry.is_directory) continue;
+            if (entry.skipped) {
+                ++unreadable;
+            } else {
+                ++report.files_backed_up;
+                report.bytes_read += entry.size;
+            }
+        }
+        report.files_skipped = entries.size() - report.directories - report.files_backed_up - unreadable;
+
+        // Carry CRCs of freshly archived files into the full entry list for the manifest.
+        // An unreadable file keeps its previous record, which an older archive holds,
+        // or stays out of the manifest so the next run tries it again.
+        if (incremental) {
+            Manifest fresh;
+            for (const auto& entry : changed) fresh.emplace(entry.name, entry);
+            for (auto& entry : entries) {
+                auto it = fresh.find(entry.name);
+                if (it == fresh.end()) continue;
+                entry.crc = it->second.crc;
+                entry.digest = it->second.digest;
+                entry.skipped = it->second.skipped;
+                auto old = previous.find(entry.name);
+                if (entry.skipped && old != previous.end()) {
+                    entry.crc = old->second.crc;
+                    entry.digest = old->second.digest;
+                    entry.size = old->second.size;
+                    entry.mtime = old->second.mtime;
+                    entry.skipped = false;
+                }
+            }
+        }
+        entries.insert(entries.end(), unlisted.begin(), unlisted.end());
+        save_manifest(manifest_file, entries);
+
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_clock).count();
+        report.end_time = format_utc(std::chrono::system_clock::now(), "%H:%M:%S");
+        return report;
+    }
+
+    void write_log(const fs::path& file, const Options& options, const Report& report) {
+        std::ofstream log(file, std::ios::trunc);
+        if (!log) throw std::runtime_error("Cannot write log " + file.string());
+        const double megabytes = static_cast<double>(report.bytes_read) / (1024.0 * 1024.0);
+        const auto whole_minutes = static_cast<long>(report.seconds / 60);
+        log << "Backup Log Report\n\n";
+        log << "Date: " << report.date << "\n";
+        log << "Time: " << report.start_time << " UTC\n";
+        log << "Machine Information:\n" << report.machine << "\n\n";
+        log << "Backup Details:\n";
+        log << "Source Path: " << options.source.string() << "\n";
+        log << "Destination Path: " << report.archive.string() << "\n";
+        log << "Compression Level: " << options.compression_level << "\n";
+        log << "Files Backed Up: " << report.files_backed_up << "\n";
+        log << "Files Unchanged: " << report.files_skipped << "\n";
+        log << "Directories Backed Up: " << report.directories << "\n";
+        if (options.detection != ChangeDetection::None && !options.deduplicate) {
+            log << "Files Deleted: " << report.deleted.size() << "\n";
+        }
+        if (options.deduplicate) {
+            log << "Chunks Referenced: " << report.chunks << "\n";
+            log << "New Chunks Stored: " << report.chunks_new << "\n";
+        }
+        log << "\n";
+        log << "Backup Summary:\n";
+        log << "Start Time: " << report.start_time << " UTC\n";
+        log << "End Time: " << report.end_time << " UTC\n";
+        log << std::fixed << std::setprecision(3);
+        log << "Total Duration: " << whole_minutes << " minutes " << report.seconds - 60.0 * whole_minutes << " seconds\n";
+        log << std::setprecision(2);
+        log << "Data Read: " << megabytes << " MB\n";
+        log << (options.deduplicate ? "Bytes Stored: " : "Archive Size: ") << static_cast<double>(report.bytes_written) / (1024.0 * 1024.0) << " MB\n";
+        log << "Throughput: " << (report.seconds > 0 ? megabytes / report.seconds : 0.0) << " MB/s\n";
+        if (!report.warnings.empty()) {
+            log << "\nWarnings:\n";
+            for (const auto& warning : report.warnings) log << warning << "\n";
+        }
+    }
+
+} // namespace backup
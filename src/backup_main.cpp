@@ -0,0 +1,91 @@
+#include "backup.h"
+#include "chunk_store.h"
+
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+namespace {
+	const char *usage =
+		"用法：backup <源路径> <目标路径> [-c|--compression 0-9] [-j|--jobs 1-1024]\n"
+		"             [--incremental | --checksum] [--dedup]\n"
+		"      backup --restore <存储目录> <快照> <文件> [输出文件]";
+
+	int usage_error(const std::string &message) {
+		std::cerr << "错误：" << message << "\n" << usage << std::endl;
+		return 1;
+	}
+
+	// Whole-argument integer in [low, high]; "abc", "3x" and out-of-range values are rejected
+	std::optional<int> parse_int(const std::string &text, int low, int high) {
+		int value = 0;
+		auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (error != std::errc() || end != text.data() + text.size() || value < low || value > high) return std::nullopt;
+		return value;
+	}
+}
+
+// Usage: backup <source> <destination> [-c|--compression LEVEL] [-j|--jobs N]
+//               [--incremental | --checksum] [--dedup]
+//        backup --restore <store> <snapshot> <file> [output]
+int main(int argc, char **argv) {
+	if (argc >= 2 && std::string(argv[1]) == "--restore") {
+		if (argc != 5 && argc != 6) return usage_error("--restore 需要存储目录、快照和文件");
+		try {
+			if (argc >= 6) {
+				std::ofstream out(argv[5], std::ios::binary | std::ios::trunc);
+				backup::restore_file(argv[2], argv[3], argv[4], out);
+			} else {
+				backup::restore_file(argv[2], argv[3], argv[4], std::cout);
+			}
+		} catch (const std::exception &error) {
+			std::cerr << "恢复失败。" << error.what() << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	if (argc < 3) return usage_error("必须提供源路径和目标路径");
+
+	backup::Options options;
+	options.source = argv[1];
+	options.destination = argv[2];
+	for (int i = 3; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "-c" || arg == "--compression" || arg == "-j" || arg == "--jobs") {
+			if (i + 1 == argc) return usage_error("选项 " + arg + " 缺少参数");
+			std::string value = argv[++i];
+			if (arg == "-c" || arg == "--compression") {
+				auto level = parse_int(value, 0, 9);
+				if (!level) return usage_error("无效的压缩等级 " + value);
+				options.compression_level = *level;
+			} else {
+				auto jobs = parse_int(value, 1, 1024);
+				if (!jobs) return usage_error("无效的线程数 " + value);
+				options.threads = static_cast<unsigned>(*jobs);
+			}
+		} else if (arg == "--incremental") {
+			options.detection = backup::ChangeDetection::Mtime;
+		} else if (arg == "--checksum") {
+			options.detection = backup::ChangeDetection::Checksum;
+		} else if (arg == "--dedup") {
+			options.deduplicate = true;
+		} else {
+			return usage_error("未知选项 " + arg);
+		}
+	}
+
+	try {
+		backup::Report report = options.deduplicate ? backup::run_dedup_backup(options) : backup::run_backup(options);
+		backup::write_log(options.destination / "backup_log.txt", options, report);
+		for (const auto &warning : report.warnings) std::cerr << "警告：" << warning << std::endl;
+		std::cout << report.archive.string() << ": " << report.files_backed_up << " files, "
+				  << report.files_skipped << " unchanged" << std::endl;
+	} catch (const std::exception &error) {
+		std::cerr << "备份失败。" << error.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,553 @@
+#include "chunk_store.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace backup {
+
+    namespace {
+
+        using detail::run_workers;
+        using detail::worker_count;
+        using detail::source_directory;
+        using detail::format_utc;
+        using detail::machine_information;
+
+        // ----------------------------------------------------------------
+        // SHA-256 (FIPS 180-4)
+        // ----------------------------------------------------------------
+
+        class Sha256 {
+        public:
+            void update(const unsigned char* data, std::size_t size) {
+                length_ += size;
+                while (size != 0) {
+                    const std::size_t take = std::min(size, std::size_t{64} - fill_);
+                    std::memcpy(block_ + fill_, data, take);
+                    fill_ += take;
+                    data += take;
+                    size -= take;
+                    if (fill_ == 64) {
+                        compress(block_);
+                        fill_ = 0;
+                    }
+                }
+            }
+
+            std::string hex_digest() {
+                const std::uint64_t bits = length_ * 8;
+                const unsigned char pad = 0x80;
+                const unsigned char zero = 0;
+                update(&pad, 1);
+                while (fill_ != 56) update(&zero, 1);
+                unsigned char tail[8];
+                for (int i = 0; i < 8; ++i) tail[i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+                update(tail, 8);
+
+                static const char* digits = "0123456789abcdef";
+                std::string out;
+                out.reserve(64);
+                for (std::uint32_t word : state_) {
+                    for (int shift = 28; shift >= 0; shift -= 4) out.push_back(digits[(word >> shift) & 0xF]);
+                }
+                return out;
+            }
+
+        private:
+            static std::uint32_t rotr(std::uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+            void compress(const unsigned char* block) {
+                static constexpr std::uint32_t k[64] = {
+                    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+                std::uint32_t w[64];
+                for (int i = 0; i < 16; ++i) {
+                    w[i] = (std::uint32_t{block[4 * i]} << 24) | (std::uint32_t{block[4 * i + 1]} << 16) |
+                           (std::uint32_t{block[4 * i + 2]} << 8) | std::uint32_t{block[4 * i + 3]};
+                }
+                for (int i = 16; i < 64; ++i) {
+                    std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+                std::uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+                std::uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+                for (int i = 0; i < 64; ++i) {
+                    std::uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+                    std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+                state_[0] += a;
+                state_[1] += b;
+                state_[2] += c;
+                state_[3] += d;
+                state_[4] += e;
+                state_[5] += f;
+                state_[6] += g;
+                state_[7] += h;
+            }
+
+            std::uint32_t state_[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                       0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            unsigned char block_[64] = {};
+            std::size_t fill_ = 0;
+            std::uint64_t length_ = 0;
+        };
+
+        // ----------------------------------------------------------------
+        // Store files
+        // ----------------------------------------------------------------
+
+        // Where a chunk lives: a byte range of a pack file
+        struct ChunkLocation {
+            std::string pack;
+            std::uint64_t offset = 0;
+            std::uint64_t stored = 0;
+            std::uint64_t raw = 0;
+        };
+
+        using ChunkIndex = std::unordered_map<std::string, ChunkLocation>;
+
+        struct SnapshotFile {
+            FileEntry entry;
+            std::vector<std::string> chunks;
+        };
+
+        // Load the index; when `wanted` is given only those hashes are kept. A last
+        // line without its newline is what a crash during an append leaves behind;
+        // its chunk is not referenced by any snapshot, so the line is ignored.
+        ChunkIndex load_index(const fs::path& file, const std::unordered_set<std::string>* wanted = nullptr) {
+            ChunkIndex index;
+            std::ifstream in(file);
+            if (!in) return index;
+            std::string line;
+            std::string hash;
+            ChunkLocation location;
+            while (std::getline(in, line)) {
+                if (in.eof()) break;
+                std::istringstream fields(line);
+                if (!(fields >> hash >> location.pack >> location.offset >> location.stored >> location.raw)) {
+                    throw std::runtime_error("Corrupt chunk index: " + file.string());
+                }
+                if (!wanted || wanted->count(hash)) index.emplace(hash, location);
+            }
+            return index;
+        }
+
+        // Cut a partial last line off the index before appending to it
+        void truncate_partial_line(const fs::path& file) {
+            std::error_code error;
+            const std::uintmax_t size = fs::file_size(file, error);
+            if (error || size == 0) return;
+            std::ifstream in(file, std::ios::binary);
+            std::string tail(static_cast<std::size_t>(std::min<std::uintmax_t>(size, 4096)), '\0');
+            in.seekg(static_cast<std::streamoff>(size - tail.size()));
+            in.read(tail.data(), static_cast<std::streamsize>(tail.size()));
+            if (!in) throw std::runtime_error("Cannot read chunk index " + file.string());
+            if (tail.back() == '\n') return;
+            const std::size_t newline = tail.rfind('\n');
+            if (newline == std::string::npos && tail.size() != size) {
+                throw std::runtime_error("Corrupt chunk index: " + file.string());
+            }
+            in.close();
+            fs::resize_file(file, size - tail.size() + (newline == std::string::npos ? 0 : newline + 1));
+        }
+
+        // Snapshot lines:
+        //   D <mode> <name>
+        //   F <mode> <mtime> <size> <name>
+        //   C <hash>                       (chunks of the preceding F line, in order)
+        // Stops after `only` when a single file is requested.
+        std::vector<SnapshotFile> load_snapshot(const fs::path& file, const std::string* only = nullptr) {
+            std::vector<SnapshotFile> files;
+            std::ifstream in(file);
+            if (!in) throw std::runtime_error("Cannot open snapshot " + file.string());
+            std::string line;
+            bool collecting = false;
+            while (std::getline(in, line)) {
+                if (line.empty() || line[0] == '#') continue;
+                std::istringstream fields(line.substr(1));
+                if (line[0] == 'C') {
+                    if (collecting) files.back().chunks.push_back(line.substr(2));
+                    continue;
+                }
+                if (collecting && only) break;
+                SnapshotFile file_entry;
+                FileEntry& entry = file_entry.entry;
+                entry.is_directory = line[0] == 'D';
+                fields >> entry.mode;
+                if (!entry.is_directory) fields >> entry.mtime >> entry.size;
+                if (!fields || fields.get() != ' ') throw std::runtime_error("Corrupt snapshot: " + file.string());
+                std::getline(fields, entry.name);
+                collecting = !only || entry.name == *only;
+                if (collecting) files.push_back(std::move(file_entry));
+            }
+            return files;
+        }
+
+        void save_snapshot(const fs::path& file, const fs::path& source, const std::vector<SnapshotFile>& files) {
+            const fs::path temporary = file.string() + ".tmp";
+            {
+                std::ofstream out(temporary, std::ios::trunc);
+                out << "# snapshot v1 of " << source.string() << "\n";
+                for (const auto& [entry, chunks] : files) {
+                    if (entry.skipped && !entry.is_directory) continue;
+                    if (entry.is_directory) {
+                        out << "D " << entry.mode << ' ' << entry.name << '\n';
+                        continue;
+                    }
+                    out << "F " << entry.mode << ' ' << entry.mtime << ' ' << entry.size << ' ' << entry.name << '\n';
+                    for (const auto& hash : chunks) out << "C " << hash << '\n';
+                }
+                if (!out) throw std::runtime_error("Cannot write snapshot " + file.string());
+            }
+            fs::rename(temporary, file);
+        }
+
+        // Snapshot ids are "YYYY-MM-DD_HHMMSS" UTC timestamps with a "-N" suffix for
+        // runs within the same second; the suffix is compared as a number so -10
+        // comes after -9
+        std::pair<std::string, unsigned long> snapshot_order(const std::string& id) {
+            const std::size_t dash = id.find('-', std::string("YYYY-MM-DD_HHMMSS").size());
+            if (dash == std::string::npos) return {id, 0};
+            return {id.substr(0, dash), std::strtoul(id.c_str() + dash + 1, nullptr, 10)};
+        }
+
+        std::optional<fs::path> latest_snapshot(const fs::path& directory) {
+            std::optional<fs::path> latest;
+            for (const auto& item : fs::directory_iterator(directory)) {
+                if (item.path().extension() == ".tmp") continue;
+                if (!latest || snapshot_order(item.path().filename().string()) >
+                                   snapshot_order(latest->filename().string())) {
+                    latest = item.path();
+                }
+            }
+            return latest;
+        }
+
+        // Exclusive flock(2) on <store>/lock held for a whole run, so two backups
+        // into one store wait for each other instead of sharing a snapshot id
+        class StoreLock {
+        public:
+            explicit StoreLock(const fs::path& store) {
+                const fs::path file = store / "lock";
+                fd_ = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+                if (fd_ < 0) throw std::runtime_error("Cannot open lock " + file.string());
+                int status;
+                while ((status = ::flock(fd_, LOCK_EX)) != 0 && errno == EINTR) {}
+                if (status != 0) {
+                    ::close(fd_);
+                    throw std::runtime_error("Cannot lock store " + store.string());
+                }
+            }
+            ~StoreLock() { ::close(fd_); }
+
+            StoreLock(const StoreLock&) = delete;
+            StoreLock& operator=(const StoreLock&) = delete;
+
+        private:
+            int fd_ = -1;
+        };
+
+        // Create a pack that did not exist before; false if the name is taken,
+        // for example by the leftover pack of a crashed run
+        bool create_pack(const fs::path& file) {
+            const int fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                if (errno == EEXIST) return false;
+                throw std::runtime_error("Cannot create pack " + file.string());
+            }
+            ::close(fd);
+            return true;
+        }
+
+        // Random 64-bit values per byte for the gear rolling hash (splitmix64)
+        const std::uint64_t* gear_table() {
+            static const auto table = [] {
+                std::vector<std::uint64_t> values(256);
+                std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+                for (auto& value : values) {
+                    std::uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+                    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                    value = z ^ (z >> 31);
+                }
+                return values;
+            }();
+            return table.data();
+        }
+
+    } // namespace
+
+    std::string sha256_hex(const void* data, std::size_t size) {
+        Sha256 hasher;
+        hasher.update(static_cast<const unsigned char*>(data), size);
+        return hasher.hex_digest();
+    }
+
+    void split_chunks(std::istream& in, const ChunkLimits& limits,
+                      const std::function<void(const char* data, std::size_t size)>& fn) {
+        const std::uint64_t* gear = gear_table();
+        int bits = 0;
+        while ((std::size_t{1} << bits) < limits.average) ++bits;
+        // Normalized chunking: the gear hash shifts left, so its high bits cover the
+        // most recent bytes. A stricter mask before the average size and a looser one
+        // after it pull chunk sizes toward the average.
+        const std::uint64_t mask_small = ~std::uint64_t{0} << (64 - std::min(bits + 1, 63));
+        const std::uint64_t mask_large = ~std::uint64_t{0} << (64 - std::max(bits - 1, 1));
+
+        std::vector<char> buffer(2 * limits.max);
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        bool eof = false;
+        while (true) {
+            if (!eof && end - begin < limits.max) {
+                std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+                end -= begin;
+                begin = 0;
+                in.read(buffer.data() + end, static_cast<std::streamsize>(buffer.size() - end));
+                end += static_cast<std::size_t>(in.gcount());
+                // A failed read is not the end of the file: storing what was read
+                // so far would record a silently truncated copy
+                if (in.bad()) throw std::ios_base::failure("Read error while chunking");
+                eof = !in;
+            }
+            const std::size_t available = end - begin;
+            if (available == 0) break;
+
+            std::size_t cut = std::min(available, limits.max);
+            if (available > limits.min) {
+                const auto* data = reinterpret_cast<const unsigned char*>(buffer.data() + begin);
+                const std::size_t normal = std::min(cut, limits.average);
+                std::uint64_t hash = 0;
+                std::size_t i = limits.min;
+                for (; i < normal; ++i) {
+                    hash = (hash << 1) + gear[data[i]];
+                    if (!(hash & mask_small)) break;
+                }
+                if (i == normal) {
+                    for (; i < cut; ++i) {
+                        hash = (hash << 1) + gear[data[i]];
+                        if (!(hash & mask_large)) break;
+                    }
+                }
+                cut = std::min(cut, i + 1);
+            }
+            fn(buffer.data() + begin, cut);
+            begin += cut;
+        }
+    }
+
+    Report run_dedup_backup(const Options& options) {
+        Report report;
+        const auto start = std::chrono::system_clock::now();
+        const auto start_clock = std::chrono::steady_clock::now();
+        report.date = format_utc(start, "%Y-%m-%d");
+        report.start_time = format_utc(start, "%H:%M:%S");
+        report.machine = machine_information();
+
+        const std::string directory_name = source_directory(options.source).filename().string();
+        const fs::path store = options.destination / (directory_name + ".store");
+        fs::create_directories(store / "packs");
+        fs::create_directories(store / "snapshots");
+        const StoreLock store_lock(store);
+
+        // The id must be new to both the snapshots and the packs, and the pack is
+        // created exclusively, so no earlier run's data is ever overwritten
+        const std::string stamp = format_utc(start, "%Y-%m-%d_%H%M%S");
+        std::string id = stamp;
+        for (int n = 1; fs::exists(store / "snapshots" / id) || !create_pack(store / "packs" / (id + ".pack")); ++n) {
+            id = stamp + "-" + std::to_string(n);
+        }
+
+        std::vector<FileEntry> entries = scan_tree(options.source, options.threads, &report.warnings);
+
+        // Previous state of each file, for skipping unchanged files by mtime
+        std::unordered_map<std::string, SnapshotFile> previous;
+        if (options.detection == ChangeDetection::Mtime) {
+            if (auto last = latest_snapshot(store / "snapshots")) {
+                for (auto& file : load_snapshot(*last)) previous.emplace(file.entry.name, std::move(file));
+            }
+        }
+
+        ChunkIndex index = load_index(store / "index");
+        std::vector<std::string> fresh;
+        const fs::path pack_file = store / "packs" / (id + ".pack");
+        std::ofstream pack(pack_file, std::ios::binary);
+        if (!pack) throw std::runtime_error("Cannot create pack " + pack_file.string());
+        std::uint64_t pack_offset = 0;
+        std::mutex store_mutex;
+
+        std::vector<SnapshotFile> files(entries.size());
+        std::atomic<std::size_t> cursor{0};
+        std::atomic<std::size_t> read_files{0};
+        std::atomic<std::size_t> unreadable{0};
+        std::atomic<std::uintmax_t> read_bytes{0};
+        std::mutex warning_mutex;
+        const int level = std::clamp(options.compression_level, 0, 9);
+        const ChunkLimits limits;
+
+        run_workers(worker_count(options.threads), [&](unsigned) {
+            std::string compressed;
+            for (std::size_t i = cursor++; i < entries.size(); i = cursor++) {
+                files[i].entry = entries[i];
+                FileEntry& entry = files[i].entry;
+                if (entry.is_directory) continue;
+
+                auto it = previous.find(entry.name);
+                if (it != previous.end() && it->second.entry.size == entry.size && it->second.entry.mtime == entry.mtime) {
+                    files[i].chunks = it->second.chunks;
+                    continue;
+                }
+
+                // Like the zip path, an unreadable file is left out of the snapshot
+                // with a warning; chunks it already stored are harmless
+                auto skip = [&](const std::string& reason) {
+                    entry.skipped = true;
+                    files[i].chunks.clear();
+                    ++unreadable;
+                    std::lock_guard lock(warning_mutex);
+                    report.warnings.push_back("Cannot read " + entry.path.string() + ": " + reason);
+                };
+                std::ifstream in(entry.path, std::ios::binary);
+                if (!in) {
+                    skip("cannot open");
+                    continue;
+                }
+                std::uintmax_t size = 0;
+                try {
+                    split_chunks(in, limits, [&](const char* data, std::size_t length) {
+                        size += length;
+                        std::string hash = sha256_hex(data, length);
+                        files[i].chunks.push_back(hash);
+                        {
+                            std::lock_guard lock(store_mutex);
+                            // An empty location reserves the hash while this worker compresses it
+                            if (!index.emplace(hash, ChunkLocation{}).second) return;
+                        }
+                        compressed.resize(compressBound(static_cast<uLong>(length)));
+                        uLongf stored = static_cast<uLongf>(compressed.size());
+                        if (compress2(reinterpret_cast<Bytef*>(compressed.data()), &stored,
+                                      reinterpret_cast<const Bytef*>(data), static_cast<uLong>(length), level) != Z_OK) {
+                            throw std::runtime_error("compress2 failed for " + entry.path.string());
+                        }
+                        std::lock_guard lock(store_mutex);
+                        pack.write(compressed.data(), static_cast<std::streamsize>(stored));
+                        if (!pack) throw std::runtime_error("Write to pack failed.");
+                        index[hash] = ChunkLocation{id, pack_offset, stored, length};
+                        pack_offset += stored;
+                        fresh.push_back(std::move(hash));
+                    });
+                } catch (const std::ios_base::failure& e) {
+                    skip(e.what());
+                    continue;
+                }
+                entry.size = size;
+                ++read_files;
+                read_bytes += size;
+            }
+        });
+
+        pack.close();
+        if (!pack) throw std::runtime_error("Closing pack failed.");
+        if (fresh.empty()) fs::remove(pack_file);
+
+        // Chunks become visible in the index only after their pack data is on disk
+        {
+            std::sort(fresh.begin(), fresh.end(), [&index](const std::string& a, const std::string& b) {
+                return index.at(a).offset < index.at(b).offset;
+            });
+            truncate_partial_line(store / "index");
+            std::ofstream out(store / "index", std::ios::app);
+            for (const auto& hash : fresh) {
+                const ChunkLocation& location = index.at(hash);
+                out << hash << ' ' << location.pack << ' ' << location.offset << ' ' << location.stored << ' '
+                    << location.raw << '\n';
+            }
+            if (!out) throw std::runtime_error("Cannot update chunk index.");
+        }
+
+        report.archive = store / "snapshots" / id;
+        save_snapshot(report.archive, options.source, files);
+
+        for (const auto& file : files) {
+            if (file.entry.is_directory) ++report.directories;
+            report.chunks += file.chunks.size();
+        }
+        report.files_backed_up = read_files;
+        report.files_skipped = entries.size() - report.directories - report.files_backed_up - unreadable;
+        report.bytes_read = read_bytes;
+        report.bytes_written = pack_offset;
+        report.chunks_new = fresh.size();
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_clock).count();
+        report.end_time = format_utc(std::chrono::system_clock::now(), "%H:%M:%S");
+        return report;
+    }
+
+    void restore_file(const fs::path& store, const fs::path& snapshot, const std::string& name, std::ostream& out) {
+        const fs::path snapshot_file = fs::exists(snapshot) ? snapshot : store / "snapshots" / snapshot;
+        const auto files = load_snapshot(snapshot_file, &name);
+        if (files.empty() || files.front().entry.is_directory) {
+            throw std::runtime_error("No file " + name + " in snapshot " + snapshot_file.string());
+        }
+        const auto& chunks = files.front().chunks;
+        const std::unordered_set<std::string> wanted(chunks.begin(), chunks.end());
+        const ChunkIndex index = load_index(store / "index", &wanted);
+
+        std::map<std::string, std::ifstream> packs;
+        std::string stored;
+        std::string raw;
+        for (const auto& hash : chunks) {
+            auto it = index.find(hash);
+            if (it == index.end()) throw std::runtime_error("Chunk " + hash + " missing from index.");
+            const ChunkLocation& location = it->second;
+
+            auto [pack, opened] = packs.try_emplace(location.pack);
+            if (opened) pack->second.open(store / "packs" / (location.pack + ".pack"), std::ios::binary);
+            stored.resize(location.stored);
+            pack->second.seekg(static_cast<std::streamoff>(location.offset));
+            pack->second.read(stored.data(), static_cast<std::streamsize>(stored.size()));
+            if (!pack->second) throw std::runtime_error("Cannot read chunk " + hash + " from pack " + location.pack);
+
+            raw.resize(location.raw);
+            uLongf length = static_cast<uLongf>(raw.size());
+            if (uncompress(reinterpret_cast<Bytef*>(raw.data()), &length,
+                           reinterpret_cast<const Bytef*>(stored.data()), static_cast<uLong>(stored.size())) != Z_OK ||
+                length != raw.size() || sha256_hex(raw.data(), raw.size()) != hash) {
+                throw std::runtime_error("Chunk " + hash + " is corrupt.");
+            }
+            out.write(raw.data(), static_cast<std::streamsize>(raw.size()));
+        }
+        if (!out) throw std::runtime_error("Writing restored file failed.");
+    }
+
+} // namespace backup
@@ -1,9 +1,17 @@
 #include "algebra.h"
+#include "algebra_cache.h"
+#include "backup.h"
+#include "chunk_store.h"
 
 #include <cmath>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <zlib.h>
 
 using namespace algebra;
 
@@ -508,3 +516,659 @@ TEST(AutAp2024SpringHW1, inverse_EmptyMatrix) {
 	EXPECT_ANY_THROW(inverse(mat))
 		<< "Inverse calculation should throw an error for an empty matrix.";
 }
+
+// "============================================="
+// "             gemv / ger / syrk Tests         "
+// "============================================="
+
+// Test matrix-vector product against the general multiply
+TEST(AutAp2024SpringHW1, gemv_MatchesMatrixMultiplication) {
+	MATRIX<int> mat = {{1, 2, 3}, {4, 5, 6}};
+	std::vector<int> x = {7, 8, 9};
+	std::vector<int> expected = {50, 122};
+
+	EXPECT_EQ(gemv(mat, x), expected) << "Matrix-vector product failed.";
+}
+
+// Test alpha/beta scaling of the in-place matrix-vector product
+TEST(AutAp2024SpringHW1, gemv_AlphaBetaUpdate) {
+	MATRIX<double> mat = {{1, 2}, {3, 4}};
+	std::vector<double> x = {1, 1};
+	std::vector<double> y = {10, 20};
+
+	gemv(mat, x, y, 2.0, 0.5);
+	EXPECT_NEAR(y[0], 11.0, 1e-12) << "gemv alpha/beta update failed.";
+	EXPECT_NEAR(y[1], 24.0, 1e-12) << "gemv alpha/beta update failed.";
+}
+
+// Test transposed matrix-vector product
+TEST(AutAp2024SpringHW1, gemv_TransposedProduct) {
+	MATRIX<int> mat = {{1, 2, 3}, {4, 5, 6}};
+	std::vector<int> x = {1, 2};
+	std::vector<int> expected = {9, 12, 15};
+
+	EXPECT_EQ(gemv_transposed(mat, x), expected)
+		<< "Transposed matrix-vector product failed.";
+}
+
+// Test matrix-vector product with dimension mismatch
+TEST(AutAp2024SpringHW1, gemv_DimensionMismatch) {
+	MATRIX<int> mat = {{1, 2}, {3, 4}};
+	std::vector<int> x = {1, 2, 3};
+
+	EXPECT_ANY_THROW(gemv(mat, x)) << "gemv should throw on dimension mismatch.";
+	EXPECT_ANY_THROW(gemv_transposed(mat, x))
+		<< "gemv_transposed should throw on dimension mismatch.";
+}
+
+// Test large matrix-vector products that take the multithreaded path
+TEST(AutAp2024SpringHW1, gemv_LargeMatrixMatchesMultiply) {
+	auto mat = create_matrix<double>(600, 500, MatrixType::Random, -1.0, 1.0);
+	auto col = create_matrix<double>(500, 1, MatrixType::Random, -1.0, 1.0);
+	std::vector<double> x(500);
+	for (size_t i = 0; i < x.size(); ++i) x[i] = col[i][0];
+
+	auto expected = multiply(mat, col);
+	auto result = gemv(mat, x);
+	for (size_t i = 0; i < result.size(); ++i) {
+		EXPECT_NEAR(result[i], expected[i][0], 1e-9)
+			<< "Large gemv mismatch at element [" << i << "].";
+	}
+
+	auto expectedT = multiply(transpose(mat), create_matrix<double>(600, 1, MatrixType::Ones));
+	auto resultT = gemv_transposed(mat, std::vector<double>(600, 1.0));
+	for (size_t j = 0; j < resultT.size(); ++j) {
+		EXPECT_NEAR(resultT[j], expectedT[j][0], 1e-9)
+			<< "Large gemv_transposed mismatch at element [" << j << "].";
+	}
+}
+
+// Test the persistent pool runs every block of many back-to-back jobs exactly once
+// and runs nested jobs inline instead of deadlocking
+TEST(AutAp2024SpringHW1, gemv_WorkerPoolReusesThreads) {
+	algebra::detail::WorkerPool pool(3);
+	ASSERT_EQ(pool.size(), 4u);
+	std::vector<int> counts(4);
+	for (int job = 0; job < 2000; ++job) {
+		auto task = [&](std::size_t block) { ++counts[block]; };
+		pool.run(4, task);
+	}
+	EXPECT_EQ(counts, std::vector<int>(4, 2000)) << "A block was lost or run twice.";
+
+	std::vector<int> nested(16);
+	auto outer = [&](std::size_t block) {
+		auto inner = [&](std::size_t b) { ++nested[block * 4 + b]; };
+		pool.run(4, inner);
+	};
+	pool.run(4, outer);
+	EXPECT_EQ(nested, std::vector<int>(16, 1)) << "Nested jobs should run inline.";
+}
+
+// Test rank-1 update
+TEST(AutAp2024SpringHW1, ger_RankOneUpdate) {
+	MATRIX<int> mat = {{1, 1, 1}, {1, 1, 1}};
+	std::vector<int> x = {1, 2};
+	std::vector<int> y = {3, 4, 5};
+	MATRIX<int> expected = {{7, 9, 11}, {13, 17, 21}};
+
+	ger(mat, x, y, 2);
+	EXPECT_EQ(mat, expected) << "Rank-1 update failed.";
+}
+
+// Test symmetric rank-k update against A * A^T
+TEST(AutAp2024SpringHW1, syrk_MatchesMultiplyByTranspose) {
+	MATRIX<int> mat = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}, {1, 0, -1}};
+
+	EXPECT_EQ(syrk(mat), multiply(mat, transpose(mat)))
+		<< "Symmetric rank-k update failed.";
+}
+
+// Test syrk's row blocks cover every row once and carry equal triangular work
+TEST(AutAp2024SpringHW1, syrk_BlocksBalanceTriangularWork) {
+	const std::size_t n = 1000, threads = 8, elements = n * (n + 1) / 2;
+	const std::size_t block = (elements + threads - 1) / threads;
+	std::size_t row = 0;
+	for (std::size_t b = 0; b < threads; ++b) {
+		const std::size_t first = algebra::detail::triangular_row(b * block, n);
+		const std::size_t last = algebra::detail::triangular_row(std::min(elements, (b + 1) * block), n);
+		EXPECT_EQ(first, row) << "Blocks must be contiguous.";
+		const std::size_t work = last * (last + 1) / 2 - first * (first + 1) / 2;
+		EXPECT_NEAR(static_cast<double>(work), static_cast<double>(elements) / threads, n) << "Block " << b;
+		row = last;
+	}
+	EXPECT_EQ(row, n);
+
+	auto mat = create_matrix<double>(120, 40, MatrixType::Random, -1.0, 1.0);
+	auto expected = multiply(mat, transpose(mat));
+	auto result = syrk(mat);
+	for (size_t i = 0; i < result.size(); ++i)
+		for (size_t j = 0; j < result.size(); ++j)
+			EXPECT_NEAR(result[i][j], expected[i][j], 1e-9) << "syrk mismatch at [" << i << "][" << j << "].";
+}
+
+// "============================================="
+// "               ResultCache Tests             "
+// "============================================="
+
+// Test repeated operations on an unchanged matrix are served from the cache
+TEST(AutAp2024SpringHW1, cache_RepeatedCallsHit) {
+	ResultCache<double> cache;
+	MATRIX<double> mat = {{4, 7}, {2, 6}};
+
+	EXPECT_NEAR(cache.determinant(mat), 10.0, 1e-12);
+	EXPECT_NEAR(cache.determinant(mat), 10.0, 1e-12);
+	auto first = cache.inverse(mat);
+	EXPECT_EQ(*first, inverse(mat));
+	auto second = cache.inverse(mat);
+	EXPECT_EQ(second, first) << "A hit should share the cached result, not copy it.";
+	EXPECT_EQ(cache.hits(), 2u) << "Repeated calls should hit the cache.";
+	EXPECT_EQ(cache.misses(), 2u) << "First call per operation should miss.";
+}
+
+// Test a modified matrix is recomputed instead of returning a stale result
+TEST(AutAp2024SpringHW1, cache_ModifiedMatrixRecomputes) {
+	ResultCache<int> cache;
+	MATRIX<int> mat = {{1, 2}, {3, 4}};
+
+	EXPECT_NEAR(cache.determinant(mat), -2.0, 1e-12);
+	mat[0][0] = 5;
+	EXPECT_NEAR(cache.determinant(mat), 14.0, 1e-12)
+		<< "Cache returned a stale determinant for a modified matrix.";
+	EXPECT_EQ(cache.hits(), 0u);
+}
+
+// Test explicit invalidation and the LRU byte budget
+TEST(AutAp2024SpringHW1, cache_InvalidateAndBudget) {
+	ResultCache<double> cache(1);
+	MATRIX<double> a = {{1, 2}, {3, 4}};
+	MATRIX<double> b = {{5, 6}, {7, 8}};
+
+	cache.inverse(a);
+	cache.inverse(b);
+	cache.inverse(b);
+	EXPECT_EQ(cache.hits(), 1u) << "Most recent entry should survive eviction.";
+	cache.inverse(a);
+	EXPECT_EQ(cache.misses(), 3u) << "Least recent entry should be evicted.";
+
+	cache.invalidate(a);
+	EXPECT_EQ(cache.size_bytes(), 0u) << "Invalidation should release the entry.";
+}
+
+// Test failed operations propagate and are not cached
+TEST(AutAp2024SpringHW1, cache_FailuresNotCached) {
+	ResultCache<double> cache;
+	MATRIX<double> mat = {{1, 2}, {2, 4}};
+
+	EXPECT_ANY_THROW(cache.inverse(mat));
+	EXPECT_ANY_THROW(cache.inverse(mat));
+	EXPECT_EQ(cache.hits(), 0u);
+}
+
+// "============================================="
+// "                 backup Tests                "
+// "============================================="
+
+namespace {
+	// Fresh source/destination pair under the system temp directory
+	struct BackupFixture {
+		std::filesystem::path root;
+		backup::Options options;
+
+		explicit BackupFixture(const std::string &name) {
+			root = std::filesystem::temp_directory_path() / ("aut_ap_backup_" + name);
+			std::filesystem::remove_all(root);
+			std::filesystem::create_directories(root / "data" / "nested");
+			write("data/a.txt", "hello");
+			write("data/nested/b.txt", std::string(100000, 'x'));
+			options.source = root / "data";
+			options.destination = root / "out";
+			options.threads = 4;
+			options.chunk_size = 32 * 1024;
+		}
+		~BackupFixture() { std::filesystem::remove_all(root); }
+
+		void write(const std::string &file, const std::string &content) {
+			std::ofstream(root / file, std::ios::binary) << content;
+		}
+	};
+}
+
+// Test the tree walk finds every file and directory
+TEST(AutAp2024SpringHW1, backup_ScanTree) {
+	BackupFixture fixture("scan");
+	auto entries = backup::scan_tree(fixture.options.source, 4);
+
+	ASSERT_EQ(entries.size(), 4u);
+	EXPECT_EQ(entries[0].name, "data/");
+	EXPECT_EQ(entries[1].name, "data/a.txt");
+	EXPECT_EQ(entries[2].name, "data/nested/");
+	EXPECT_EQ(entries[3].name, "data/nested/b.txt");
+	EXPECT_EQ(entries[3].size, 100000u);
+}
+
+// Test a file split into dictionary-primed chunks across several windows
+// inflates back to the original content
+TEST(AutAp2024SpringHW1, backup_MultiChunkEntryInflates) {
+	BackupFixture fixture("inflate");
+	std::string content;
+	for (int i = 0; content.size() < 300000; ++i) content += "line " + std::to_string(i * 7919 % 1000) + "\n";
+	fixture.write("data/big.txt", content);
+	fixture.options.batch_bytes = 64 * 1024;
+
+	std::vector<backup::FileEntry> entries;
+	for (auto &entry : backup::scan_tree(fixture.options.source, 4))
+		if (entry.name == "data/big.txt") entries.push_back(entry);
+	ASSERT_EQ(entries.size(), 1u);
+	const auto archive = fixture.root / "single.zip";
+	backup::write_zip(archive, entries, fixture.options);
+
+	std::ifstream in(archive, std::ios::binary);
+	std::string zip((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	auto field = [&zip](std::size_t at, int bytes) {
+		std::uint32_t value = 0;
+		for (int i = bytes - 1; i >= 0; --i) value = (value << 8) | static_cast<unsigned char>(zip[at + i]);
+		return value;
+	};
+	ASSERT_EQ(field(0, 4), 0x04034b50u);
+	const std::uint32_t crc = field(14, 4);
+	const std::uint32_t stored = field(18, 4);
+	ASSERT_EQ(field(22, 4), content.size());
+	const std::size_t data = 30 + field(26, 2) + field(28, 2);
+
+	std::string inflated(content.size(), '\0');
+	z_stream stream{};
+	ASSERT_EQ(inflateInit2(&stream, -15), Z_OK);
+	stream.next_in = reinterpret_cast<Bytef *>(zip.data() + data);
+	stream.avail_in = stored;
+	stream.next_out = reinterpret_cast<Bytef *>(inflated.data());
+	stream.avail_out = static_cast<uInt>(inflated.size());
+	EXPECT_EQ(inflate(&stream, Z_FINISH), Z_STREAM_END) << "Chunk streams did not concatenate.";
+	EXPECT_EQ(stream.total_out, content.size());
+	inflateEnd(&stream);
+	EXPECT_EQ(inflated, content);
+	EXPECT_EQ(crc, crc32(0L, reinterpret_cast<const Bytef *>(content.data()), static_cast<uInt>(content.size())));
+}
+
+// Test a full backup records the CRC and digest of each file in the manifest
+TEST(AutAp2024SpringHW1, backup_FullBackupWritesManifest) {
+	BackupFixture fixture("full");
+	auto report = backup::run_backup(fixture.options);
+
+	EXPECT_TRUE(std::filesystem::exists(report.archive));
+	EXPECT_EQ(report.files_backed_up, 2u);
+	EXPECT_EQ(report.directories, 2u);
+	EXPECT_LT(report.bytes_written, report.bytes_read) << "Archive should be compressed.";
+
+	auto manifest = backup::load_manifest(fixture.options.destination / ".data.manifest");
+	ASSERT_EQ(manifest.count("data/a.txt"), 1u);
+	EXPECT_EQ(manifest["data/a.txt"].crc, 0x3610a686u) << "CRC-32 of \"hello\" is wrong.";
+	EXPECT_EQ(manifest["data/a.txt"].digest.size(), 64u) << "Manifest should hold a SHA-256 digest.";
+	EXPECT_EQ(manifest["data/nested/b.txt"].digest,
+		backup::detail::content_digest(fixture.root / "data" / "nested" / "b.txt", fixture.options.chunk_size))
+		<< "The digest of a multi-chunk file should match a re-read.";
+
+	std::ifstream in(fixture.options.destination / ".data.manifest");
+	std::string header;
+	std::getline(in, header);
+	EXPECT_EQ(header.rfind("# backup manifest v2", 0), 0u);
+}
+
+// Test --checksum still reads v1 manifests, treating their files as changed
+TEST(AutAp2024SpringHW1, backup_ChecksumReadsV1Manifest) {
+	BackupFixture fixture("manifest_v1");
+	std::filesystem::create_directories(fixture.options.destination);
+	fixture.write("out/.data.manifest", "# backup manifest v1: crc32 size mtime name\n907060870 5 0\tdata/a.txt\n");
+
+	auto manifest = backup::load_manifest(fixture.options.destination / ".data.manifest");
+	ASSERT_EQ(manifest.count("data/a.txt"), 1u);
+	EXPECT_EQ(manifest["data/a.txt"].crc, 0x3610a686u);
+	EXPECT_TRUE(manifest["data/a.txt"].digest.empty());
+
+	fixture.options.detection = backup::ChangeDetection::Checksum;
+	auto report = backup::run_backup(fixture.options);
+	EXPECT_EQ(report.files_backed_up, 2u) << "A file without a recorded digest must be archived again.";
+}
+
+// Test incremental backups only archive changed files
+TEST(AutAp2024SpringHW1, backup_IncrementalSkipsUnchanged) {
+	BackupFixture fixture("incremental");
+	backup::run_backup(fixture.options);
+
+	fixture.options.detection = backup::ChangeDetection::Checksum;
+	auto unchanged = backup::run_backup(fixture.options);
+	EXPECT_EQ(unchanged.files_backed_up, 0u);
+	EXPECT_EQ(unchanged.files_skipped, 2u);
+
+	fixture.write("data/a.txt", "world");
+	auto changed = backup::run_backup(fixture.options);
+	EXPECT_EQ(changed.files_backed_up, 1u) << "Only the modified file should be archived.";
+	EXPECT_EQ(changed.files_skipped, 1u);
+}
+
+// Test --incremental trusts size and mtime without reading unchanged files
+TEST(AutAp2024SpringHW1, backup_IncrementalByMtime) {
+	BackupFixture fixture("incremental_mtime");
+	backup::run_backup(fixture.options);
+
+	fixture.options.detection = backup::ChangeDetection::Mtime;
+	auto unchanged = backup::run_backup(fixture.options);
+	EXPECT_EQ(unchanged.files_backed_up, 0u);
+	EXPECT_EQ(unchanged.files_skipped, 2u);
+
+	// Same size, new content: only the timestamp tells them apart
+	const auto file = fixture.root / "data" / "a.txt";
+	const auto mtime = std::filesystem::last_write_time(file);
+	fixture.write("data/a.txt", "world");
+	std::filesystem::last_write_time(file, mtime + std::chrono::seconds(1));
+	auto touched = backup::run_backup(fixture.options);
+	EXPECT_EQ(touched.files_backed_up, 1u) << "A newer mtime should be archived.";
+	EXPECT_EQ(touched.files_skipped, 1u);
+	EXPECT_EQ(backup::load_manifest(fixture.options.destination / ".data.manifest")["data/a.txt"].crc, 0x3a771143u)
+		<< "Manifest should hold the CRC-32 of \"world\".";
+
+	fixture.write("data/a.txt", "hello");
+	std::filesystem::last_write_time(file, mtime + std::chrono::seconds(1));
+	auto restamped = backup::run_backup(fixture.options);
+	EXPECT_EQ(restamped.files_backed_up, 0u) << "Mtime mode must not read files whose size and mtime match.";
+}
+
+// Test back-to-back incrementals never overwrite each other
+TEST(AutAp2024SpringHW1, backup_IncrementalArchivesAreUnique) {
+	BackupFixture fixture("incremental_unique");
+	backup::run_backup(fixture.options);
+
+	fixture.options.detection = backup::ChangeDetection::Mtime;
+	fixture.write("data/a.txt", "changed once");
+	auto first = backup::run_backup(fixture.options);
+	auto second = backup::run_backup(fixture.options);
+
+	EXPECT_NE(first.archive, second.archive) << "Second incremental replaced the first.";
+	EXPECT_TRUE(std::filesystem::exists(first.archive));
+	EXPECT_EQ(first.files_backed_up, 1u);
+	EXPECT_EQ(second.files_backed_up, 0u);
+	EXPECT_GT(std::filesystem::file_size(first.archive), std::filesystem::file_size(second.archive))
+		<< "The first incremental must still hold the change.";
+}
+
+// Test incrementals list files deleted since the previous run beside the archive
+TEST(AutAp2024SpringHW1, backup_IncrementalRecordsDeletions) {
+	BackupFixture fixture("deletions");
+	backup::run_backup(fixture.options);
+
+	std::filesystem::remove(fixture.root / "data" / "a.txt");
+	fixture.options.detection = backup::ChangeDetection::Mtime;
+	auto report = backup::run_backup(fixture.options);
+	ASSERT_EQ(report.deleted, std::vector<std::string>{"data/a.txt"});
+
+	std::ifstream list(std::filesystem::path(report.archive).replace_extension(".deleted"));
+	std::string line;
+	ASSERT_TRUE(std::getline(list, line)) << "Deletion list was not written.";
+	EXPECT_EQ(line, "data/a.txt");
+	EXPECT_EQ(backup::load_manifest(fixture.options.destination / ".data.manifest").count("data/a.txt"), 0u);
+
+	auto next = backup::run_backup(fixture.options);
+	EXPECT_TRUE(next.deleted.empty()) << "A deletion is recorded once.";
+}
+
+// Test a file that shrinks after the scan is left out with a warning
+// instead of aborting the backup
+TEST(AutAp2024SpringHW1, backup_ShrunkFileIsSkipped) {
+	BackupFixture fixture("shrunk");
+	fixture.write("data/z.txt", "after");
+	auto entries = backup::scan_tree(fixture.options.source, 4);
+	fixture.write("data/nested/b.txt", std::string(50000, 'x'));
+
+	std::vector<std::string> warnings;
+	const auto archive = fixture.root / "shrunk.zip";
+	const auto size = backup::write_zip(archive, entries, fixture.options, &warnings);
+
+	ASSERT_EQ(warnings.size(), 1u);
+	EXPECT_NE(warnings[0].find("b.txt"), std::string::npos);
+	EXPECT_TRUE(entries[3].skipped);
+	EXPECT_FALSE(entries[4].skipped);
+	EXPECT_EQ(std::filesystem::file_size(archive), size) << "Abandoned bytes were left behind.";
+
+	// End of central directory: 4 entries, the central directory right before it
+	std::ifstream in(archive, std::ios::binary);
+	std::string zip((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	const std::string tail = zip.substr(zip.size() - 22);
+	EXPECT_EQ(tail.substr(0, 4), std::string("PK\x05\x06"));
+	EXPECT_EQ(static_cast<unsigned char>(tail[10]), 4u);
+}
+
+// "============================================="
+// "              chunk_store Tests              "
+// "============================================="
+
+namespace {
+	std::string random_bytes(std::size_t size, unsigned seed) {
+		std::mt19937 gen(seed);
+		std::string data(size, '\0');
+		for (auto &c : data) c = static_cast<char>(gen() & 0xFF);
+		return data;
+	}
+
+	std::vector<std::string> chunk_hashes(const std::string &data) {
+		std::vector<std::string> hashes;
+		std::istringstream in(data);
+		backup::split_chunks(in, backup::ChunkLimits{}, [&](const char *chunk, std::size_t size) {
+			hashes.push_back(backup::sha256_hex(chunk, size));
+		});
+		return hashes;
+	}
+
+	// Serves `size` bytes, then fails like a disk read error would
+	class FailingBuffer : public std::streambuf {
+	public:
+		explicit FailingBuffer(std::size_t size) : data_(size, 'x') {}
+
+	protected:
+		int_type underflow() override {
+			if (served_) throw std::runtime_error("I/O error");
+			served_ = true;
+			setg(data_.data(), data_.data(), data_.data() + data_.size());
+			return traits_type::to_int_type(data_[0]);
+		}
+
+	private:
+		std::string data_;
+		bool served_ = false;
+	};
+}
+
+// Test SHA-256 against the FIPS 180-4 examples
+TEST(AutAp2024SpringHW1, chunk_store_Sha256KnownVectors) {
+	EXPECT_EQ(backup::sha256_hex("", 0),
+			  "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	std::string message = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	EXPECT_EQ(backup::sha256_hex(message.data(), message.size()),
+			  "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+// Test chunk boundaries resynchronize after an insertion near the start
+TEST(AutAp2024SpringHW1, chunk_store_ChunkingIsContentDefined) {
+	std::string data = random_bytes(2 << 20, 7);
+	auto original = chunk_hashes(data);
+	auto shifted = chunk_hashes("inserted bytes" + data);
+
+	ASSERT_GT(original.size(), 8u);
+	std::size_t shared = 0;
+	for (const auto &hash : shifted) {
+		shared += std::count(original.begin(), original.end(), hash);
+	}
+	EXPECT_GE(shared, original.size() - 2) << "Only chunks near the edit should change.";
+}
+
+// Test a read error is reported instead of being taken for the end of the file
+TEST(AutAp2024SpringHW1, chunk_store_ReadErrorThrows) {
+	FailingBuffer buffer(100000);
+	std::istream in(&buffer);
+	std::size_t total = 0;
+	EXPECT_THROW(backup::split_chunks(in, backup::ChunkLimits{}, [&](const char *, std::size_t size) { total += size; }),
+				 std::ios_base::failure);
+	EXPECT_LT(total, 100000u);
+}
+
+// Test a second snapshot stores only new chunks and files restore individually
+TEST(AutAp2024SpringHW1, chunk_store_DeduplicatesAndRestores) {
+	BackupFixture fixture("dedup");
+	std::string big = random_bytes(1 << 20, 11);
+	fixture.write("data/nested/big.bin", big);
+	fixture.options.deduplicate = true;
+
+	auto first = backup::run_dedup_backup(fixture.options);
+	EXPECT_EQ(first.files_backed_up, 3u);
+	EXPECT_EQ(first.chunks_new, first.chunks);
+
+	fixture.write("data/nested/big.bin", big + "tail");
+	fixture.options.detection = backup::ChangeDetection::Mtime;
+	auto second = backup::run_dedup_backup(fixture.options);
+	EXPECT_LE(second.chunks_new, 1u) << "Appending should add at most one chunk.";
+	EXPECT_LT(second.bytes_written, 300000u);
+
+	const auto store = fixture.options.destination / "data.store";
+	std::ostringstream restored;
+	backup::restore_file(store, second.archive.filename(), "data/nested/big.bin", restored);
+	EXPECT_EQ(restored.str(), big + "tail");
+
+	std::ostringstream old_version;
+	backup::restore_file(store, first.archive, "data/a.txt", old_version);
+	EXPECT_EQ(old_version.str(), "hello");
+	EXPECT_ANY_THROW(backup::restore_file(store, first.archive, "data/missing.txt", old_version));
+}
+
+// Test a partial index line left by a crash mid-append does not break the store
+TEST(AutAp2024SpringHW1, chunk_store_IgnoresPartialIndexLine) {
+	BackupFixture fixture("partial_index");
+	fixture.options.deduplicate = true;
+	backup::run_dedup_backup(fixture.options);
+
+	const auto store = fixture.options.destination / "data.store";
+	std::ofstream(store / "index", std::ios::app) << "3f2a9c 2026-01-01_000000 12";
+	fixture.write("data/a.txt", "changed");
+	auto report = backup::run_dedup_backup(fixture.options);
+
+	std::ifstream index(store / "index");
+	std::string content((std::istreambuf_iterator<char>(index)), std::istreambuf_iterator<char>());
+	EXPECT_EQ(content.find("3f2a9c"), std::string::npos) << "Partial line should be cut before appending.";
+	std::ostringstream restored;
+	backup::restore_file(store, report.archive, "data/a.txt", restored);
+	EXPECT_EQ(restored.str(), "changed");
+}
+
+// Test two runs into one store at once keep separate packs and snapshots
+TEST(AutAp2024SpringHW1, chunk_store_OverlappingRunsDoNotCollide) {
+	BackupFixture first("overlap_a");
+	BackupFixture second("overlap_b");
+	second.write("data/a.txt", "other tree");
+	first.options.deduplicate = second.options.deduplicate = true;
+	second.options.destination = first.options.destination;
+	const auto store = first.options.destination / "data.store";
+	// A crashed run may leave a pack behind under the id a new run would pick
+	std::filesystem::create_directories(store / "packs");
+	for (const char *id : {"", "-1", "-2"}) {
+		const auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+		char stamp[32];
+		std::strftime(stamp, sizeof stamp, "%Y-%m-%d_%H%M%S", std::gmtime(&now));
+		std::ofstream(store / "packs" / (std::string(stamp) + id + ".pack")) << "leftover";
+	}
+
+	backup::Report reports[2];
+	std::thread other([&] { reports[1] = backup::run_dedup_backup(second.options); });
+	reports[0] = backup::run_dedup_backup(first.options);
+	other.join();
+
+	EXPECT_NE(reports[0].archive, reports[1].archive) << "Both runs wrote the same snapshot.";
+	std::ostringstream a, b;
+	backup::restore_file(store, reports[0].archive, "data/a.txt", a);
+	backup::restore_file(store, reports[1].archive, "data/a.txt", b);
+	EXPECT_EQ(a.str(), "hello");
+	EXPECT_EQ(b.str(), "other tree");
+}
+
+// Test the newest snapshot is chosen by its numeric suffix, so -10 follows -9
+TEST(AutAp2024SpringHW1, chunk_store_LatestSnapshotOrdersSuffixNumerically) {
+	BackupFixture fixture("snapshot_order");
+	fixture.options.deduplicate = true;
+	auto first = backup::run_dedup_backup(fixture.options);
+
+	const auto snapshots = first.archive.parent_path();
+	std::filesystem::copy_file(first.archive, snapshots / (first.archive.filename().string() + "-10"));
+	std::ofstream(snapshots / (first.archive.filename().string() + "-9")) << "# snapshot v1 of nothing\n";
+
+	fixture.options.detection = backup::ChangeDetection::Mtime;
+	auto next = backup::run_dedup_backup(fixture.options);
+	EXPECT_EQ(next.files_backed_up, 0u) << "The empty -9 snapshot was taken for the newest.";
+}
+
+// "============================================="
+// "          Expected / policy Tests            "
+// "============================================="
+
+// Test try_* functions return values and error codes without throwing
+TEST(AutAp2024SpringHW1, expected_ReturnsErrorsAsValues) {
+	MATRIX<int> matrixA = {{1, 2}, {3, 4}};
+	MATRIX<int> matrixB = {{5, 6}, {7, 8}, {9, 10}};
+
+	auto product = try_multiply(matrixA, matrixA);
+	ASSERT_TRUE(product.has_value());
+	EXPECT_EQ(*product, multiply(matrixA, matrixA));
+
+	auto mismatch = try_multiply(matrixA, matrixB);
+	EXPECT_FALSE(mismatch) << "Dimension mismatch should be reported as a value.";
+	EXPECT_EQ(mismatch.error(), Errc::IncompatibleDimensions);
+	EXPECT_EQ(try_sum_sub(matrixA, matrixB).error(), Errc::DimensionMismatch);
+	EXPECT_EQ(try_trace(matrixB).error(), Errc::NotSquare);
+	EXPECT_EQ(try_inverse(MATRIX<double>{{1, 2}, {2, 4}}).error(), Errc::Singular);
+	EXPECT_EQ(try_create_matrix<double>(2, 2, MatrixType::Random).error(), Errc::MissingBounds);
+	EXPECT_EQ((try_create_matrix<double, Checked>(0, 2).error()), Errc::InvalidDimensions);
+	EXPECT_EQ(try_determinant(MATRIX<double>{}).error(), Errc::EmptyMatrix);
+	EXPECT_NEAR(try_determinant(matrixA).value_or(0.0), -2.0, 1e-12);
+}
+
+// Test value() on an error raises the exception type of the throwing API
+TEST(AutAp2024SpringHW1, expected_ValueRethrows) {
+	MATRIX<int> mat = {{1, 2, 3}};
+
+	EXPECT_THROW(try_trace(mat).value(), std::invalid_argument);
+	EXPECT_THROW(try_create_matrix<int>(0, 3).value(), std::logic_error);
+}
+
+// Test validation can be hoisted out of a loop with the Unchecked policy
+TEST(AutAp2024SpringHW1, expected_UncheckedPolicy) {
+	MATRIX<double> mat = {{2, 0}, {0, 2}};
+	std::vector<double> x = {1, 1};
+	std::vector<double> y(2);
+
+	ASSERT_EQ(validate_gemv(mat, x, y), Errc::Ok);
+	for (int i = 0; i < 3; ++i) {
+		gemv<Unchecked>(mat, x, y);
+		x = y;
+	}
+	EXPECT_EQ(y, (std::vector<double>{8, 8}));
+	EXPECT_EQ(*try_trace<Unchecked>(mat), 4.0);
+	EXPECT_EQ(try_sum_sub<Unchecked>(mat, mat, "sub")->at(0).at(0), 0.0);
+}
+
+// Test the 2x2-only limit is reported even when validation is skipped
+TEST(AutAp2024SpringHW1, expected_UncheckedKeepsOperationLimits) {
+	MATRIX<double> big = {{1, 2, 3}, {4, 5, 6}, {7, 8, 10}};
+	MATRIX<double> one = {{5}};
+
+	EXPECT_EQ(try_determinant<Unchecked>(big).error(), Errc::NotImplemented);
+	EXPECT_EQ(try_inverse<Unchecked>(big).error(), Errc::NotImplemented);
+	EXPECT_EQ(try_determinant<Unchecked>(one).error(), Errc::NotImplemented);
+	EXPECT_EQ(try_inverse<Unchecked>(one).error(), Errc::NotImplemented);
+	EXPECT_EQ(try_inverse<Unchecked>(MATRIX<double>{{1, 2}, {2, 4}}).error(), Errc::Singular);
+}
+
+// Test element-wise operations and transpose accept empty matrices
+TEST(AutAp2024SpringHW1, expected_EmptyElementwise) {
+	MATRIX<int> empty = {};
+
+	EXPECT_EQ(sum_sub(empty, empty), empty);
+	EXPECT_EQ(hadamard_product(empty, empty), empty);
+	EXPECT_EQ(transpose(empty), empty);
+	EXPECT_ANY_THROW(multiply(empty, empty));
+	EXPECT_ANY_THROW(trace(empty));
+}